@@ -0,0 +1,229 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "local_search.hpp"
+#include "polish.hpp"
+#include "instance.hpp"
+#include "generator.hpp"
+#include "coordinates.hpp"
+
+
+/** Throughput of the candidate list descent, with and without Lin-Kernighan chains, against the callback polish. */
+namespace bench {
+    using clock = std::chrono::high_resolution_clock;
+
+    [[gnu::cold]]
+    static double since(clock::time_point start) {
+        std::chrono::duration<double> secs = clock::now() - start;
+        return secs.count();
+    }
+
+    [[gnu::cold]]
+    static tour shuffled(size_t n, std::mt19937_64& rng) {
+        auto order = tour();
+        order.resize(n);
+        std::iota(order.begin(), order.end(), 0U);
+        std::shuffle(order.begin(), order.end(), rng);
+        return order;
+    }
+
+    /** Boustrophedon over horizontal strips, a cheap space filling start. */
+    [[gnu::cold]]
+    static tour strips(std::span<const vertex> vertices, uint8_t i) {
+        const size_t n = vertices.size();
+        double low = std::numeric_limits<double>::infinity(), high = -low;
+        for (const auto& v : vertices) {
+            low = std::min(low, v[i][1]);
+            high = std::max(high, v[i][1]);
+        }
+        const double height = std::max(1e-9, (high - low) / std::max(1.0, std::sqrt(n / 2.0)));
+
+        auto order = tour();
+        order.resize(n);
+        std::iota(order.begin(), order.end(), 0U);
+        std::sort(order.begin(), order.end(), [&](unsigned a, unsigned b) {
+            const auto sa = unsigned((vertices[a][i][1] - low) / height);
+            const auto sb = unsigned((vertices[b][i][1] - low) / height);
+            if (sa != sb) {
+                return sa < sb;
+            }
+            const bool odd = sa % 2 == 1;
+            return odd ? vertices[a][i][0] > vertices[b][i][0] : vertices[a][i][0] < vertices[b][i][0];
+        });
+        return order;
+    }
+
+    /** Uniform points in [0, side)^2 for both spaces. */
+    [[gnu::cold]]
+    static std::vector<vertex> uniform(size_t n, double side, uint64_t seed) {
+        auto rng = std::mt19937_64(seed);
+        auto coord = std::uniform_real_distribution<double>(0, side);
+
+        auto vertices = std::vector<vertex>();
+        vertices.reserve(n);
+        for (size_t v = 0; v < n; v++) {
+            const double x1 = coord(rng), y1 = coord(rng), x2 = coord(rng), y2 = coord(rng);
+            vertices.push_back(vertex::with_id(v + 1, x1, y1, x2, y2));
+        }
+        return vertices;
+    }
+
+    /** Throughput of the instance parser over `vertices`, written with integral coordinates. */
+    [[gnu::cold]]
+    static void parse(std::span<const vertex> vertices) {
+        auto buf = std::ostringstream();
+        for (const auto& v : vertices) {
+            buf << std::lround(v[0][0]) << ' ' << std::lround(v[0][1]) << ' '
+                << std::lround(v[1][0]) << ' ' << std::lround(v[1][1]) << '\n';
+        }
+        const auto text = buf.str();
+
+        const auto start = clock::now();
+        const auto parsed = instance::parse(text);
+        const double secs = since(start);
+        std::cout << "Instance parsing: " << parsed.size() << " vertices, " << text.size() / 1e6 << " MB in "
+            << secs << " secs, " << (text.size() / secs) / 1e6 << " MB/sec" << std::endl;
+    }
+
+    /**
+     * Cost table fill of the first space: the former `ceil(hypot(...))` over the vertex records,
+     * the current kernel over the records, and the current kernel over the coordinate arrays.
+     * Each fills a table already touched, so only the computation and the writes are timed.
+     */
+    [[gnu::cold]]
+    static void tabulate(std::span<const vertex> vertices) {
+        const size_t n = vertices.size();
+        auto table = utils::matrix<double>(n);
+        std::fill_n(table[0].data(), table.total(), 0.0);
+
+        auto start = clock::now();
+        for (unsigned u = 0; u < n; u++) {
+            for (unsigned v = 0; v < n; v++) {
+                const auto &p = vertices[u][0], &q = vertices[v][0];
+                table[u][v] = std::ceil(std::hypot(p[0] - q[0], p[1] - q[1]));
+            }
+        }
+        const double hypot = since(start);
+
+        start = clock::now();
+        for (unsigned u = 0; u < n; u++) {
+            for (unsigned v = 0; v < n; v++) {
+                table[u][v] = vertices[u][0].cost<metric::ceil_2d>(vertices[v][0]);
+            }
+        }
+        const double records = since(start);
+
+        const auto coords = utils::columns(vertices);
+        const auto space = coords[0];
+        start = clock::now();
+        for (unsigned u = 0; u < n; u++) {
+            const double xu = space.x[u], yu = space.y[u];
+            double *row = table[u].data();
+            for (unsigned v = 0; v < n; v++) {
+                row[v] = metric::ceil_2d::cost(xu, yu, space.x[v], space.y[v]);
+            }
+        }
+        const double arrays = since(start);
+
+        std::cout << "Cost table (n=" << n << "): " << hypot << " secs with hypot over vertices, " << records
+            << " secs over vertices, " << arrays << " secs over coordinate arrays, " << hypot / arrays << "x" << std::endl;
+
+        const auto each = [&space](auto policy) {
+            using Metric = decltype(policy);
+            const auto start = clock::now();
+            const auto table = utils::tabulate<Metric>(space);
+            std::cout << "    " << Metric::name << ": " << since(start) << " secs, checksum " << table[1][0] << std::endl;
+        };
+        each(metric::ceil_2d {});
+        each(metric::euc_2d {});
+        each(metric::att {});
+        each(metric::geo {});
+    }
+
+    /** Time to generate `n` vertices of each distribution. */
+    [[gnu::cold]]
+    static void generate(size_t n) {
+        const auto dists = { utils::distribution::uniform, utils::distribution::clustered, utils::distribution::correlated };
+        const char *names[] = { "uniform", "clustered", "correlated" };
+
+        for (const auto dist : dists) {
+            const auto start = clock::now();
+            const auto vertices = generator(n, 1, dist).generate();
+            std::cout << "Instance generation (" << names[unsigned(dist)] << "): " << vertices.size()
+                << " vertices in " << since(start) << " secs" << std::endl;
+        }
+    }
+
+    [[gnu::cold]]
+    static void run(const char *name, std::span<const vertex> vertices, unsigned repeats, bool with_polish) {
+        auto rng = std::mt19937_64(vertices.size());
+        std::cout << name << " (n=" << vertices.size() << ")" << std::endl;
+
+        const auto coords = utils::columns(vertices);
+        for (uint8_t i = 0; i <= 1; i++) {
+            auto start = clock::now();
+            const auto near = neighbors::nearest<metric::ceil_2d>(coords[i]);
+            std::cout << "  Space " << i+1 << ": candidate lists in " << since(start) << " secs" << std::endl;
+
+            for (const unsigned depth : { 0U, utils::lk_depth }) {
+                for (const bool random : { true, false }) {
+                    double before = 0, after = 0, secs = 0;
+                    uint64_t evaluations = 0, moves = 0;
+                    for (unsigned rep = 0; rep < repeats; rep++) {
+                        const auto initial = random ? shuffled(vertices.size(), rng) : strips(vertices, i);
+                        before += initial.cost<metric::ceil_2d>(i, vertices);
+
+                        start = clock::now();
+                        auto search = local_search(utils::space_cost<metric::ceil_2d> { coords[i] }, near, initial, depth);
+                        search.activate_all();
+                        search.optimize();
+                        secs += since(start);
+
+                        after += search.result().cost<metric::ceil_2d>(i, vertices);
+                        evaluations += search.evaluations();
+                        moves += search.moves();
+                    }
+                    std::cout << "    " << (depth > 0 ? "Lin-Kernighan" : "2-opt/Or-opt")
+                        << " from " << (random ? "random" : "strips") << ": cost "
+                        << before / repeats << " -> " << after / repeats
+                        << " in " << secs / repeats << " secs, " << evaluations / repeats << " evaluations, "
+                        << moves / repeats << " moves, " << (evaluations / secs) / 1e6 << "M evaluations/sec" << std::endl;
+                }
+            }
+
+            if (with_polish) {
+                const auto initial = shuffled(vertices.size(), rng);
+                start = clock::now();
+                const auto polished = polish<metric::ceil_2d>::improve(vertices, 0, { initial, initial });
+                const double secs = since(start);
+
+                const double cost = polished ? (*polished)[i].cost<metric::ceil_2d>(i, vertices) : initial.cost<metric::ceil_2d>(i, vertices);
+                std::cout << "    polish (k=0): cost " << initial.cost<metric::ceil_2d>(i, vertices) << " -> " << cost
+                    << " in " << secs << " secs (both spaces)" << std::endl;
+            }
+        }
+    }
+}
+
+
+int main() {
+    bench::run("Default instance", DEFAULT_VERTICES, 100, true);
+
+    const auto generated = bench::uniform(10000, 1000.0, 1);
+    bench::run("Uniform instance", generated, 3, false);
+
+    bench::parse(bench::uniform(1000000, 1000000.0, 2));
+    bench::generate(1000000);
+    bench::tabulate(generator(5000, 1, utils::distribution::uniform).generate());
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,432 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gurobi_c++.h>
+#include "vertex.hpp"
+#include "tour.hpp"
+#include "patch.hpp"
+#include "graph.hpp"
+
+
+/**
+ * Logic-based Benders decomposition over the shared edges. The master chooses at least `k`
+ * edges with binary `z` variables and estimates the cost of each tour with `theta`, bounded
+ * below by a fractional 2-matching `x_i` over the costs of space `i` that contains the chosen
+ * edges, `x_i >= z`, so the master prices the edges it picks from the start. Given the chosen
+ * edges the tours are independent, so each is solved as a plain TSP with those edges forced,
+ * both at once, on two threads with an environment each. Each answer goes back to the master
+ * as a no-good cut per tour,
+ *
+ *     theta_i >= T_i(Z) - (T_i(Z) - LB_i) * sum_{e in Z} (1 - z_e),
+ *
+ * valid because forcing more edges never makes a tour cheaper. `LB_i` is the cost of the
+ * unconstrained tour. Chosen edges that close a cycle are cut off without any subproblem.
+ */
+template <typename Metric>
+struct benders final {
+private:
+    const GRBEnv& env;
+    /** Of the second tour, whose subproblems run on their own thread. */
+    const GRBEnv side;
+    GRBModel master;
+    utils::matrix<GRBVar> z;
+    utils::pair<utils::matrix<GRBVar>> x;
+    utils::pair<GRBVar> theta;
+    utils::pair<double> lower;
+
+    utils::pair<tour> best;
+    double upper;
+    double bound = 0.0;
+
+    unsigned solved = 0;
+    unsigned optimality_cuts = 0;
+    unsigned feasibility_cuts = 0;
+    unsigned improvements = 0;
+
+    std::optional<double> limit;
+    std::string_view stop = "iteration limit";
+
+    [[gnu::pure]] [[gnu::hot]]
+    inline double cost(const utils::pair<tour>& tours) const noexcept {
+        return tours[0].cost<Metric>(this->data.space(0)) + tours[1].cost<Metric>(this->data.space(1));
+    }
+
+    /** Tour `i` alone, in space `i`, with the edges in `chosen` forced into it. */
+    [[gnu::cold]]
+    inline graph<Metric, 1> single(uint8_t i, const std::vector<std::pair<unsigned, unsigned>>& chosen) const {
+        auto filter = utils::basic_edge_filter<1>::every(this->order());
+        for (const auto& [u, v] : chosen) {
+            filter.forced[0][u][v] = filter.forced[0][v][u] = true;
+        }
+        return graph<Metric, 1>(this->data, i == 0 ? this->env : this->side, 0, std::move(filter), utils::sharing::pairwise, { i });
+    }
+
+    /** Seconds left before the time limit, if there is one. */
+    [[gnu::pure]] [[gnu::hot]]
+    inline std::optional<double> remaining() const {
+        if (!this->limit) [[likely]] {
+            return std::nullopt;
+        }
+        return std::max(0.0, *this->limit - this->elapsed());
+    }
+
+    /**
+     * Both tours solved with the edges in `chosen` forced into them, the second on its own
+     * thread, and if they are proven optimal, which the cuts need. Only the time limit stops
+     * them early.
+     */
+    [[gnu::hot]]
+    std::pair<utils::pair<tour>, bool> subproblem(const std::vector<std::pair<unsigned, unsigned>>& chosen) {
+        auto subs = utils::pair<graph<Metric, 1>> { this->single(0, chosen), this->single(1, chosen) };
+        if (const auto secs = this->remaining()) [[unlikely]] {
+            for (auto& sub : subs) {
+                sub.time_limit(*secs);
+            }
+        }
+
+        auto errors = utils::pair<std::exception_ptr>();
+        auto worker = std::thread([&subs, &errors] {
+            try {
+                subs[1].solve();
+            } catch (...) {
+                errors[1] = std::current_exception();
+            }
+        });
+        try {
+            subs[0].solve();
+        } catch (...) {
+            errors[0] = std::current_exception();
+        }
+        worker.join();
+
+        for (const auto& error : errors) {
+            if (!error) [[likely]] {
+                continue;
+            }
+            try {
+                std::rethrow_exception(error);
+            } catch (const utils::invalid_solution&) {
+                if (!this->limit) [[unlikely]] {
+                    throw;
+                }
+                return { this->best, false };
+            }
+        }
+        this->solved += 1;
+        return { { subs[0].tour(0), subs[1].tour(0) }, subs[0].optimal() && subs[1].optimal() };
+    }
+
+    [[gnu::cold]]
+    void build_master() {
+        const size_t n = this->order();
+        auto total = GRBLinExpr();
+
+        for (unsigned u = 0; u < n; u++) {
+            for (unsigned v = u + 1; v < n; v++) {
+                auto z_uv = this->master.addVar(0., 1., 0., GRB_BINARY);
+                this->z[u][v] = z_uv;
+                this->z[v][u] = z_uv;
+                total += z_uv;
+            }
+        }
+        this->master.addConstr(total, GRB_GREATER_EQUAL, this->k);
+
+        // the shared edges are part of a tour, so no vertex has more than two
+        for (unsigned u = 0; u < n; u++) {
+            auto expr = GRBLinExpr();
+            for (unsigned v = 0; v < n; v++) {
+                if (u != v) [[likely]] {
+                    expr += this->z[u][v];
+                }
+            }
+            this->master.addConstr(expr, GRB_LESS_EQUAL, 2.);
+        }
+
+        // each tour relaxed to a fractional 2-matching over its own costs, through the chosen edges
+        for (uint8_t i = 0; i <= 1; i++) {
+            const auto& costs = this->data.costs(i);
+            auto estimate = GRBLinExpr();
+            for (unsigned u = 0; u < n; u++) {
+                for (unsigned v = u + 1; v < n; v++) {
+                    auto x_uv = this->master.addVar(0., 1., 0., GRB_CONTINUOUS);
+                    this->x[i][u][v] = x_uv;
+                    this->x[i][v][u] = x_uv;
+                    estimate += costs[u][v] * x_uv;
+                    this->master.addConstr(x_uv, GRB_GREATER_EQUAL, this->z[u][v]);
+                }
+            }
+            for (unsigned u = 0; u < n; u++) {
+                auto expr = GRBLinExpr();
+                for (unsigned v = 0; v < n; v++) {
+                    if (u != v) [[likely]] {
+                        expr += this->x[i][u][v];
+                    }
+                }
+                this->master.addConstr(expr, GRB_EQUAL, 2.);
+            }
+
+            this->theta[i] = this->master.addVar(this->lower[i], GRB_INFINITY, 1., GRB_CONTINUOUS);
+            this->master.addConstr(this->theta[i], GRB_GREATER_EQUAL, estimate);
+        }
+        this->master.update();
+    }
+
+    [[gnu::hot]]
+    std::vector<std::pair<unsigned, unsigned>> chosen_edges() const {
+        const size_t n = this->order();
+        auto chosen = std::vector<std::pair<unsigned, unsigned>>();
+
+        for (unsigned u = 0; u < n; u++) {
+            for (unsigned v = u + 1; v < n; v++) {
+                if (this->z[u][v].get(GRB_DoubleAttr_X) > 0.5) [[unlikely]] {
+                    chosen.emplace_back(u, v);
+                }
+            }
+        }
+        return chosen;
+    }
+
+    /** Vertices of a cycle shorter than a tour formed by `chosen`, if there is one. */
+    [[gnu::hot]]
+    std::optional<std::vector<unsigned>> short_cycle(const std::vector<std::pair<unsigned, unsigned>>& chosen) const {
+        const size_t n = this->order();
+        auto parent = std::vector<unsigned>(n);
+        std::iota(parent.begin(), parent.end(), 0U);
+
+        const auto find = [&parent](unsigned v) {
+            while (parent[v] != v) {
+                v = parent[v] = parent[parent[v]];
+            }
+            return v;
+        };
+
+        for (const auto& [u, v] : chosen) {
+            const unsigned ru = find(u), rv = find(v);
+            if (ru != rv) [[likely]] {
+                parent[ru] = rv;
+                continue;
+            }
+
+            auto cycle = std::vector<unsigned>();
+            for (unsigned w = 0; w < n; w++) {
+                if (find(w) == ru) {
+                    cycle.push_back(w);
+                }
+            }
+            if (cycle.size() < n) [[likely]] {
+                return cycle;
+            }
+        }
+        return std::nullopt;
+    }
+
+    [[gnu::hot]]
+    void cut_cycle(const std::vector<unsigned>& cycle) {
+        auto expr = GRBLinExpr();
+        for (unsigned a = 0; a < cycle.size(); a++) {
+            for (unsigned b = a + 1; b < cycle.size(); b++) {
+                expr += this->z[cycle[a]][cycle[b]];
+            }
+        }
+        this->master.addConstr(expr, GRB_LESS_EQUAL, cycle.size() - 1);
+        this->feasibility_cuts += 1;
+    }
+
+    [[gnu::hot]]
+    void cut_tour(uint8_t i, double cost, const std::vector<std::pair<unsigned, unsigned>>& chosen) {
+        const double slope = cost - this->lower[i];
+        if (slope <= 0.5) [[unlikely]] {
+            return;
+        }
+
+        auto expr = GRBLinExpr(this->theta[i]);
+        for (const auto& [u, v] : chosen) {
+            expr += (-slope) * this->z[u][v];
+        }
+        this->master.addConstr(expr, GRB_GREATER_EQUAL, cost - slope * chosen.size());
+        this->optimality_cuts += 1;
+    }
+
+public:
+    /**
+     * Starts from `initial`, a `k`-similar pair of tours over `vertices`, as the incumbent. The
+     * master and the first tour use `env`, the second tour `side`, so both can solve at once.
+     */
+    [[gnu::cold]]
+    benders(
+        const instance& data,
+        const GRBEnv& env,
+        GRBEnv side,
+        unsigned k,
+        const utils::pair<tour>& initial,
+        unsigned max_iterations = 100
+    ):
+        env(env), side(std::move(side)), master(env), z(data.size()),
+        x({ utils::matrix<GRBVar>(data.size()), utils::matrix<GRBVar>(data.size()) }), theta(), lower({ 0.0, 0.0 }),
+        best(initial), upper(0.0), data(data), vertices(data.vertices()), k(k), max_iterations(max_iterations)
+    {
+        this->upper = this->cost(this->best);
+    }
+
+    /** Shared by every subproblem, so each space is tabulated once. */
+    const instance data;
+    const std::span<const vertex> vertices;
+    /** Minimum number of shared edges between tours. */
+    const unsigned k;
+    /** Maximum number of master problems solved. */
+    const unsigned max_iterations;
+
+    /** Number of vertices. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline size_t order() const noexcept {
+        return this->vertices.size();
+    }
+
+    /** Number of edges. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline size_t size() const noexcept {
+        const size_t order = this->order();
+        return (order * (order - 1)) / 2;
+    }
+
+    using clock = std::chrono::high_resolution_clock;
+    const clock::time_point start = clock::now();
+
+    [[gnu::cold]] [[gnu::nothrow]]
+    inline double elapsed() const noexcept {
+        auto end = clock::now();
+        std::chrono::duration<double> secs = end - this->start;
+        return secs.count();
+    }
+
+    /** Stops `solve` after `secs` seconds, keeping the best pair and bound found so far. */
+    [[gnu::cold]]
+    void time_limit(double secs) {
+        this->limit = secs;
+    }
+
+    [[gnu::hot]]
+    double solve() {
+        const auto [free, exact] = this->subproblem({});
+        if (!exact) [[unlikely]] {
+            this->stop = "time limit";
+            return this->elapsed();
+        }
+        for (uint8_t i = 0; i <= 1; i++) {
+            this->lower[i] = free[i].template cost<Metric>(i, this->vertices);
+        }
+        this->bound = this->lower[0] + this->lower[1];
+        this->build_master();
+
+        for (unsigned iter = 0; iter < this->max_iterations; iter++) {
+            if (const auto secs = this->remaining()) [[unlikely]] {
+                this->master.set(GRB_DoubleParam_TimeLimit, *secs);
+            }
+            this->master.optimize();
+            if (this->master.get(GRB_IntAttr_Status) != GRB_OPTIMAL) [[unlikely]] {
+                this->stop = this->master.get(GRB_IntAttr_Status) == GRB_TIME_LIMIT ? "time limit" : "master stopped";
+                break;
+            }
+            this->bound = std::max(this->bound, this->master.get(GRB_DoubleAttr_ObjVal));
+            if (this->bound >= this->upper - 0.5) [[unlikely]] {
+                this->stop = "optimal";
+                break;
+            }
+
+            const auto chosen = this->chosen_edges();
+            if (const auto cycle = this->short_cycle(chosen)) [[unlikely]] {
+                this->cut_cycle(*cycle);
+                continue;
+            }
+
+            if (this->remaining() == 0.0) [[unlikely]] {
+                this->stop = "time limit";
+                break;
+            }
+            const auto [tours, optimal] = this->subproblem(chosen);
+            const double cost = this->cost(tours);
+            if (cost < this->upper - 0.5) [[unlikely]] {
+                this->best = tours;
+                this->upper = cost;
+                this->improvements += 1;
+            }
+            if (!optimal) [[unlikely]] {
+                // a tour that is not proven optimal would cut off cheaper ones
+                this->stop = "time limit";
+                break;
+            }
+            for (uint8_t i = 0; i <= 1; i++) {
+                this->cut_tour(i, tours[i].template cost<Metric>(i, this->vertices), chosen);
+            }
+        }
+        return this->elapsed();
+    }
+
+    /** Why `solve` stopped. */
+    [[gnu::pure]] [[gnu::cold]]
+    std::string_view status() const {
+        return this->stop;
+    }
+
+    /** Number of times the incumbent improved, counting the initial one. */
+    [[gnu::pure]] [[gnu::cold]]
+    int64_t solution_count() const {
+        return this->improvements + 1;
+    }
+
+    /** Subproblems solved, counting the unconstrained one. */
+    [[gnu::pure]] [[gnu::cold]]
+    int64_t iterations() const {
+        return this->solved;
+    }
+
+    /** Optimality and feasibility cuts added to the master. */
+    [[gnu::pure]] [[gnu::cold]]
+    utils::pair<unsigned> cut_count() const {
+        return { this->optimality_cuts, this->feasibility_cuts };
+    }
+
+    /** Best bound proven by the master. */
+    [[gnu::pure]] [[gnu::cold]]
+    double lower_bound() const {
+        return this->bound;
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    double solution_cost() const {
+        return this->upper;
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    unsigned similarity() const {
+        return patch<Metric>::shared(this->best[0], this->best[1]);
+    }
+
+    /** Best pair found, as indices into `vertices`. */
+    [[gnu::pure]] [[gnu::cold]]
+    const utils::pair<tour>& tours() const {
+        return this->best;
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    auto solution(uint8_t i) const {
+        auto vertices = std::vector<vertex>();
+        vertices.reserve(this->order());
+
+        for (unsigned v : this->best[i]) {
+            vertices.push_back(this->vertices[v]);
+        }
+        return vertices;
+    }
+};
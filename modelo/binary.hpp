@@ -0,0 +1,225 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "vertex.hpp"
+#include "instance.hpp"
+#include "local_search.hpp"
+
+
+/**
+ * Versioned little-endian binary instances, mapped and used in place. After a 64 byte header
+ * come the `n` ids as 32-bit integers, then the coordinates as structure of arrays: `n` x and
+ * `n` y of the first space, then of the second, as 64-bit floats. The searches read these
+ * columns straight from the mapping, with no `vertex` built and nothing copied. Optionally,
+ * the candidate lists of both spaces follow as `2 n width` 32-bit indices, also read in
+ * place. The header also keeps the metric, zero being `CEIL_2D`.
+ */
+struct binary_instance final {
+private:
+    static_assert(std::endian::native == std::endian::little, "binary instances are little-endian.");
+    static_assert(sizeof(double) == 8 && std::numeric_limits<double>::is_iec559);
+
+    static constexpr char magic[8] = { 'P', 'A', 'I', 'R', 'T', 'S', 'P', '\0' };
+    /** Version 1 stored `vertex` records instead of columns. */
+    static constexpr uint32_t current_version = 2;
+    /** One x and one y column per space. */
+    static constexpr size_t column_count = 2 * vertex::spaces;
+
+    struct header final {
+    public:
+        char magic[8];
+        uint32_t version;
+        uint32_t width;
+        uint64_t count;
+        uint64_t ids;
+        uint64_t coordinates;
+        uint64_t candidates;
+        uint32_t metric;
+        uint32_t reserved[3];
+    };
+    static_assert(sizeof(header) == 64);
+
+    mapped_file file;
+    std::span<const int32_t> id_column;
+    utils::pair<std::span<const double>> x;
+    utils::pair<std::span<const double>> y;
+    std::span<const unsigned> lists;
+    unsigned list_width = 0;
+    metric::kind measure = metric::kind::ceil_2d;
+
+    [[gnu::cold]]
+    static size_t aligned(size_t offset) noexcept {
+        return (offset + 63) & ~size_t(63);
+    }
+
+    /** View of `count` items of `Item` at `offset` of `bytes`, if they fit in it and are aligned. */
+    template <typename Item>
+    [[gnu::cold]]
+    static std::optional<std::span<const Item>> section(std::string_view bytes, uint64_t offset, uint64_t count) noexcept {
+        // compared by division, so no count in the header can wrap a product around
+        if (offset > bytes.size() || offset % alignof(Item) != 0 || count > (bytes.size() - offset) / sizeof(Item)) [[unlikely]] {
+            return std::nullopt;
+        }
+        return std::span(reinterpret_cast<const Item *>(bytes.data() + offset), count);
+    }
+
+public:
+    /** Maps `path`, checking its header and that every section fits in it. */
+    [[gnu::cold]]
+    explicit binary_instance(const std::string& path): file(path) {
+        const auto bytes = this->file.contents();
+        if (bytes.size() < sizeof(header)) [[unlikely]] {
+            throw utils::invalid_file::is_empty_or_missing(path);
+        }
+
+        header head;
+        std::memcpy(&head, bytes.data(), sizeof(header));
+        if (std::memcmp(head.magic, magic, sizeof(magic)) != 0) [[unlikely]] {
+            throw utils::invalid_file::contains_invalid_data(path);
+        } else if (head.version != current_version) [[unlikely]] {
+            throw utils::invalid_file::uses_unsupported(path, "version " + std::to_string(head.version));
+        } else if (head.metric > uint32_t(metric::kind::geo)) [[unlikely]] {
+            throw utils::invalid_file::uses_unsupported(path, "metric " + std::to_string(head.metric));
+        }
+
+        const auto ids = section<int32_t>(bytes, head.ids, head.count);
+        const auto coords = head.count > std::numeric_limits<uint64_t>::max() / column_count
+            ? std::nullopt : section<double>(bytes, head.coordinates, column_count * head.count);
+        if (!ids || !coords) [[unlikely]] {
+            throw utils::invalid_file::contains_invalid_data(path);
+        }
+        const bool positive = std::all_of(ids->begin(), ids->end(), [](int32_t id) {
+            return id > 0;
+        });
+        if (!positive) [[unlikely]] {
+            throw utils::invalid_file::contains_invalid_data(path);
+        }
+
+        this->id_column = *ids;
+        for (uint8_t i = 0; i < vertex::spaces; i++) {
+            this->x[i] = coords->subspan(2 * i * head.count, head.count);
+            this->y[i] = coords->subspan((2 * i + 1) * head.count, head.count);
+        }
+        this->measure = metric::kind(head.metric);
+
+        if (head.width > 0) {
+            const uint64_t per_space = head.count == 0 ? 0 : (bytes.size() / sizeof(unsigned)) / head.count;
+            const auto lists = head.width > per_space / 2
+                ? std::nullopt : section<unsigned>(bytes, head.candidates, 2 * head.count * head.width);
+            if (!lists) [[unlikely]] {
+                throw utils::invalid_file::contains_invalid_data(path);
+            }
+            const bool inside = std::all_of(lists->begin(), lists->end(), [&head](unsigned v) {
+                return v < head.count;
+            });
+            if (!inside) [[unlikely]] {
+                throw utils::invalid_file::contains_invalid_data(path);
+            }
+            this->lists = *lists;
+            this->list_width = head.width;
+        }
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline size_t size() const noexcept {
+        return this->id_column.size();
+    }
+
+    /** Id of each vertex, in the mapping. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline std::span<const int32_t> ids() const noexcept {
+        return this->id_column;
+    }
+
+    /** Coordinates of both spaces, viewed in the mapping, which must outlive them. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline utils::columns columns() const noexcept {
+        return utils::columns::view(this->x, this->y);
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline metric::kind metric() const noexcept {
+        return this->measure;
+    }
+
+    /** Stored candidate lists of space `i` over the first `n` vertices, if there are any, viewed in the mapping. */
+    [[gnu::cold]]
+    std::optional<neighbors> candidates(uint8_t i, size_t n) const {
+        if (this->list_width == 0 || n != this->size()) [[unlikely]] {
+            return std::nullopt;
+        }
+        const size_t len = n * this->list_width;
+        return neighbors::view(this->lists.subspan(i * len, len), this->list_width);
+    }
+
+    /** Writes the vertices of `data`, and both candidate lists if given, as a binary instance. */
+    [[gnu::cold]]
+    static void write(const std::string& path, const instance& data, const utils::pair<neighbors> *near = nullptr) {
+        auto file = std::ofstream(path, std::ios::out | std::ios::trunc | std::ios::binary);
+        if (!file) [[unlikely]] {
+            throw utils::invalid_file::is_not_writable(path);
+        }
+
+        const size_t n = data.size();
+        const unsigned width = near ? (*near)[0].width : 0;
+        header head = {};
+        std::memcpy(head.magic, magic, sizeof(magic));
+        head.version = current_version;
+        head.width = width;
+        head.count = n;
+        head.ids = aligned(sizeof(header));
+        head.coordinates = aligned(head.ids + n * sizeof(int32_t));
+        head.candidates = width > 0 ? aligned(head.coordinates + column_count * n * sizeof(double)) : 0;
+        head.metric = uint32_t(data.metric());
+
+        const auto pad = [&file](size_t offset) {
+            static constexpr char zeros[64] = {};
+            file.write(zeros, aligned(offset) - offset);
+        };
+        const auto column = [&file](std::span<const double> values) {
+            file.write(reinterpret_cast<const char *>(values.data()), values.size_bytes());
+        };
+
+        file.write(reinterpret_cast<const char *>(&head), sizeof(header));
+        pad(sizeof(header));
+        for (unsigned v = 0; v < n; v++) {
+            const auto id = int32_t(data.id(v));
+            file.write(reinterpret_cast<const char *>(&id), sizeof(id));
+        }
+        pad(head.ids + n * sizeof(int32_t));
+        for (uint8_t i = 0; i < vertex::spaces; i++) {
+            column(data.space(i).x);
+            column(data.space(i).y);
+        }
+        if (width > 0) [[likely]] {
+            pad(head.coordinates + column_count * n * sizeof(double));
+            for (uint8_t i = 0; i <= 1; i++) {
+                for (unsigned u = 0; u < n; u++) {
+                    const auto list = (*near)[i][u];
+                    file.write(reinterpret_cast<const char *>(list.data()), list.size_bytes());
+                }
+            }
+        }
+
+        if (!file.flush()) [[unlikely]] {
+            throw utils::invalid_file::is_not_writable(path);
+        }
+    }
+
+    /** If `path` names a binary instance, by its extension. */
+    [[gnu::pure]] [[gnu::cold]]
+    static bool matches(std::string_view path) noexcept {
+        return path.ends_with(".bin");
+    }
+};
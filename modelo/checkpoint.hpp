@@ -0,0 +1,317 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "vertex.hpp"
+#include "tour.hpp"
+#include "progress.hpp"
+
+
+namespace utils {
+    struct invalid_checkpoint final : public std::runtime_error {
+    private:
+        [[gnu::cold]]
+        explicit inline invalid_checkpoint(const std::string& message): std::runtime_error(message) { }
+
+    public:
+        [[gnu::cold]]
+        static invalid_checkpoint unreadable(const std::string& path) {
+            std::ostringstream buf;
+            buf << "Could not read checkpoint '" << path << "'.";
+            return invalid_checkpoint(buf.str());
+        }
+
+        [[gnu::cold]]
+        static invalid_checkpoint malformed(const std::string& path, unsigned line) {
+            std::ostringstream buf;
+            buf << "Malformed checkpoint '" << path << "' at line " << line << ".";
+            return invalid_checkpoint(buf.str());
+        }
+
+        [[gnu::cold]]
+        static invalid_checkpoint mismatch(const std::string& path, unsigned n, unsigned k) {
+            std::ostringstream buf;
+            buf << "Checkpoint '" << path << "' was saved with -n " << n << " -k " << k << ", resume with the same.";
+            return invalid_checkpoint(buf.str());
+        }
+
+        /** Saved with another `what` than the one of the model resumed. */
+        [[gnu::cold]]
+        static invalid_checkpoint mismatch(const std::string& path, std::string_view what) {
+            std::ostringstream buf;
+            buf << "Checkpoint '" << path << "' was saved with a different " << what << ", resume with the same.";
+            return invalid_checkpoint(buf.str());
+        }
+    };
+
+    /** FNV-1a hash of `bytes`, continuing from `seed`, to tell apart the data checkpoints are saved for. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    static inline uint64_t fingerprint(std::span<const std::byte> bytes, uint64_t seed = 14695981039346656037U) noexcept {
+        for (const std::byte byte : bytes) {
+            seed = (seed ^ uint64_t(byte)) * 1099511628211U;
+        }
+        return seed;
+    }
+
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    static inline uint64_t fingerprint(double value, uint64_t seed) noexcept {
+        std::byte bytes[sizeof(value)];
+        std::memcpy(bytes, &value, sizeof(value));
+        return fingerprint(bytes, seed);
+    }
+
+    /** Subtour elimination constraint over the vertices in `cycle`, for tour `i`. */
+    struct saved_cut final {
+    public:
+        uint8_t i;
+        std::vector<unsigned> cycle;
+    };
+}
+
+
+/**
+ * Everything a long solve learned that survives a restart: the parameters of the model, the
+ * incumbent pair and every subtour elimination constraint added so far. Saved as plain text,
+ *
+ *     checkpoint <n> <k>
+ *     model <metric> <sharing> <space> <space>
+ *     hash <coordinates> <edges>
+ *     incumbent <cost>
+ *     tour <i> <v>...
+ *     cut <i> <v>...
+ */
+struct checkpoint final {
+public:
+    unsigned n;
+    unsigned k;
+    /** Name of the metric of the costs, so also of `cost`. */
+    std::string metric;
+    /** How the `k` shared edges are counted, `pairwise` or `common`. */
+    std::string sharing;
+    /** Coordinate space of each tour. */
+    utils::pair<unsigned> spaces = { 0, 1 };
+    /** Hash of the coordinates of the vertices, in both spaces. */
+    uint64_t coordinates = 0;
+    /** Hash of the edges of each tour in a reduced model, zero for a full one. */
+    uint64_t edges = 0;
+    std::optional<utils::pair<tour>> incumbent;
+    double cost = std::numeric_limits<double>::infinity();
+    std::vector<utils::saved_cut> cuts;
+
+    /** Hash of the ids and coordinates of `vertices`, in order. */
+    [[gnu::pure]] [[gnu::cold]]
+    static uint64_t hash(std::span<const vertex> vertices) {
+        uint64_t seed = utils::fingerprint(std::span<const std::byte>());
+        for (const auto& v : vertices) {
+            seed = utils::fingerprint(double(v.id()), seed);
+            for (uint8_t i = 0; i < vertex::spaces; i++) {
+                seed = utils::fingerprint(v[i][1], utils::fingerprint(v[i][0], seed));
+            }
+        }
+        return seed;
+    }
+
+    /** The first parameter besides `n` and `k` this was saved with that differs in `other`, if any. */
+    [[gnu::pure]] [[gnu::cold]]
+    std::optional<std::string_view> differs(const checkpoint& other) const {
+        if (this->metric != other.metric) [[unlikely]] {
+            return "metric";
+        } else if (this->sharing != other.sharing) [[unlikely]] {
+            return "sharing";
+        } else if (this->spaces != other.spaces) [[unlikely]] {
+            return "tour spaces";
+        } else if (this->coordinates != other.coordinates) [[unlikely]] {
+            return "coordinates";
+        } else if (this->edges != other.edges) [[unlikely]] {
+            return "model edges";
+        }
+        return std::nullopt;
+    }
+
+    /** If `t` visits each of `0..n-1` exactly once. */
+    [[gnu::pure]] [[gnu::cold]]
+    static bool permutation(const tour& t, unsigned n) {
+        if (t.size() != n || n == 0) [[unlikely]] {
+            return false;
+        }
+        auto seen = std::vector<bool>(n, false);
+        for (const unsigned v : t) {
+            if (v >= n || seen[v]) [[unlikely]] {
+                return false;
+            }
+            seen[v] = true;
+        }
+        return true;
+    }
+
+    [[gnu::cold]]
+    static checkpoint load(const std::string& path) {
+        auto file = std::ifstream(path);
+        if (!file) [[unlikely]] {
+            throw utils::invalid_checkpoint::unreadable(path);
+        }
+
+        auto result = checkpoint { 0, 0 };
+        auto tours = utils::pair<tour>();
+        auto tour_lines = utils::pair<unsigned> { 0, 0 };
+        auto line = std::string();
+        for (unsigned number = 1; std::getline(file, line); number++) {
+            auto fields = std::istringstream(line);
+            auto kind = std::string();
+            fields >> kind;
+
+            if (kind == "checkpoint") {
+                if (!(fields >> result.n >> result.k)) [[unlikely]] {
+                    throw utils::invalid_checkpoint::malformed(path, number);
+                }
+            } else if (kind == "model") {
+                if (!(fields >> result.metric >> result.sharing >> result.spaces[0] >> result.spaces[1])) [[unlikely]] {
+                    throw utils::invalid_checkpoint::malformed(path, number);
+                }
+            } else if (kind == "hash") {
+                if (!(fields >> std::hex >> result.coordinates >> result.edges >> std::dec)) [[unlikely]] {
+                    throw utils::invalid_checkpoint::malformed(path, number);
+                }
+            } else if (kind == "incumbent") {
+                if (!(fields >> result.cost)) [[unlikely]] {
+                    throw utils::invalid_checkpoint::malformed(path, number);
+                }
+            } else if (kind == "tour" || kind == "cut") {
+                unsigned i = 2, v;
+                auto vertices = std::vector<unsigned>();
+                if (!(fields >> i)) [[unlikely]] {
+                    throw utils::invalid_checkpoint::malformed(path, number);
+                }
+                while (fields >> v) {
+                    if (v >= result.n) [[unlikely]] {
+                        throw utils::invalid_checkpoint::malformed(path, number);
+                    }
+                    vertices.push_back(v);
+                }
+                if (i > 1 || vertices.empty()) [[unlikely]] {
+                    throw utils::invalid_checkpoint::malformed(path, number);
+                }
+
+                if (kind == "cut") {
+                    result.cuts.push_back({ uint8_t(i), std::move(vertices) });
+                } else {
+                    tours[i].assign(vertices.begin(), vertices.end());
+                    tour_lines[i] = number;
+                }
+            } else if (!kind.empty()) [[unlikely]] {
+                throw utils::invalid_checkpoint::malformed(path, number);
+            }
+
+            // every field was read, so anything left on the line is a token that failed to parse
+            fields.clear();
+            fields >> std::ws;
+            if (!fields.eof()) [[unlikely]] {
+                throw utils::invalid_checkpoint::malformed(path, number);
+            }
+        }
+
+        if (tour_lines[0] == 0 && tour_lines[1] == 0) [[unlikely]] {
+            return result;
+        }
+        for (uint8_t i = 0; i <= 1; i++) {
+            if (!permutation(tours[i], result.n)) [[unlikely]] {
+                throw utils::invalid_checkpoint::malformed(path, tour_lines[i] > 0 ? tour_lines[i] : tour_lines[1 - i]);
+            }
+        }
+        result.incumbent = std::move(tours);
+        return result;
+    }
+
+    /** Writes to a temporary file first, so an interrupted save keeps the previous one. */
+    [[gnu::cold]]
+    void save(const std::string& path) const {
+        const auto temporary = path + ".tmp";
+        {
+            auto file = std::ofstream(temporary, std::ios::out | std::ios::trunc);
+            if (!file) [[unlikely]] {
+                throw utils::invalid_file::is_not_writable(temporary);
+            }
+            file.precision(17);
+
+            file << "checkpoint " << this->n << ' ' << this->k << '\n';
+            file << "model " << this->metric << ' ' << this->sharing << ' ' << this->spaces[0] << ' ' << this->spaces[1] << '\n';
+            file << "hash " << std::hex << this->coordinates << ' ' << this->edges << std::dec << '\n';
+            if (this->incumbent) [[likely]] {
+                file << "incumbent " << this->cost << '\n';
+                for (uint8_t i = 0; i <= 1; i++) {
+                    file << "tour " << unsigned(i) << ' ' << utils::join((*this->incumbent)[i], " ") << '\n';
+                }
+            }
+            for (const auto& cut : this->cuts) {
+                file << "cut " << unsigned(cut.i) << ' ' << utils::join(cut.cycle, " ") << '\n';
+            }
+            if (!file.flush()) [[unlikely]] {
+                throw utils::invalid_file::is_not_writable(temporary);
+            }
+        }
+        if (std::rename(temporary.c_str(), path.c_str()) != 0) [[unlikely]] {
+            throw utils::invalid_file::is_not_writable(path);
+        }
+    }
+};
+
+
+/** Saves a checkpoint to `path` every `interval` seconds of solver time, if it changed since the last. */
+struct checkpointer final {
+private:
+    double last = 0.0;
+    bool changed = false;
+
+public:
+    [[gnu::cold]]
+    checkpointer(std::string path, double interval, checkpoint state):
+        path(std::move(path)), interval(interval), state(std::move(state))
+    { }
+
+    const std::string path;
+    const double interval;
+    checkpoint state;
+
+    [[gnu::hot]]
+    void cut(uint8_t i, const tour& cycle) {
+        this->state.cuts.push_back({ i, cycle });
+        this->changed = true;
+    }
+
+    [[gnu::hot]]
+    void incumbent(const utils::pair<tour>& tours, double cost) {
+        if (cost < this->state.cost) [[likely]] {
+            this->state.incumbent = tours;
+            this->state.cost = cost;
+            this->changed = true;
+        }
+    }
+
+    /** Saves if `interval` has passed since the last save at solver time `time`. */
+    [[gnu::hot]]
+    void tick(double time) {
+        if (this->changed && time - this->last >= this->interval) [[unlikely]] {
+            this->last = time;
+            this->save();
+        }
+    }
+
+    [[gnu::cold]]
+    void save() {
+        this->state.save(this->path);
+        this->changed = false;
+    }
+};
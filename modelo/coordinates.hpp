@@ -1,258 +1,112 @@
-/* AUTO GENERATED */
 #pragma once
 
 #include <array>
+#include <cstdint>
+#include <string_view>
 #include "vertex.hpp"
 
-static const constexpr std::array<vertex, 250> DEFAULT_VERTICES = {
-    vertex::with_id<  1U>(85.0, 88.0, 89.0, 87.0),
-    vertex::with_id<  2U>(47.0, 13.0, 44.0, 38.0),
-    vertex::with_id<  3U>(54.0,  4.0, 75.0, 92.0),
-    vertex::with_id<  4U>(34.0,  6.0, 26.0, 72.0),
-    vertex::with_id<  5U>(78.0, 48.0,  7.0, 91.0),
-    vertex::with_id<  6U>(69.0, 73.0, 41.0, 80.0),
-    vertex::with_id<  7U>(17.0, 63.0, 87.0, 18.0),
-    vertex::with_id<  8U>(62.0, 34.0, 65.0, 24.0),
-    vertex::with_id<  9U>(92.0, 62.0, 34.0,  6.0),
-    vertex::with_id< 10U>(96.0, 89.0, 67.0, 16.0),
-    vertex::with_id< 11U>(76.0, 32.0, 30.0, 59.0),
-    vertex::with_id< 12U>(10.0, 99.0,  9.0, 38.0),
-    vertex::with_id< 13U>(74.0, 59.0, 77.0, 81.0),
-    vertex::with_id< 14U>(98.0, 53.0, 59.0, 20.0),
-    vertex::with_id< 15U>(37.0,  2.0, 26.0, 90.0),
-    vertex::with_id< 16U>( 5.0, 54.0, 19.0, 49.0),
-    vertex::with_id< 17U>( 0.0,  6.0, 84.0, 93.0),
-    vertex::with_id< 18U>(63.0, 55.0, 76.0, 89.0),
-    vertex::with_id< 19U>(89.0, 20.0,  9.0, 65.0),
-    vertex::with_id< 20U>(75.0, 34.0, 39.0, 83.0),
-    vertex::with_id< 21U>(15.0, 60.0, 25.0, 50.0),
-    vertex::with_id< 22U>(77.0, 37.0, 63.0, 33.0),
-    vertex::with_id< 23U>(77.0, 92.0, 45.0,  9.0),
-    vertex::with_id< 24U>(20.0, 88.0, 32.0, 83.0),
-    vertex::with_id< 25U>( 0.0, 57.0, 16.0, 31.0),
-    vertex::with_id< 26U>(52.0, 33.0, 59.0, 69.0),
-    vertex::with_id< 27U>(76.0, 55.0, 30.0, 21.0),
-    vertex::with_id< 28U>(36.0, 45.0, 28.0, 99.0),
-    vertex::with_id< 29U>(58.0, 29.0, 56.0,  3.0),
-    vertex::with_id< 30U>( 4.0, 84.0, 27.0, 75.0),
-    vertex::with_id< 31U>( 0.0, 51.0, 28.0, 62.0),
-    vertex::with_id< 32U>(86.0, 83.0, 37.0, 69.0),
-    vertex::with_id< 33U>(98.0, 96.0, 66.0, 77.0),
-    vertex::with_id< 34U>( 8.0, 14.0,  9.0, 52.0),
-    vertex::with_id< 35U>(65.0, 28.0, 95.0, 44.0),
-    vertex::with_id< 36U>(59.0, 16.0, 76.0, 46.0),
-    vertex::with_id< 37U>(15.0, 58.0, 90.0,  8.0),
-    vertex::with_id< 38U>(22.0, 87.0, 51.0, 18.0),
-    vertex::with_id< 39U>(92.0, 31.0, 53.0, 87.0),
-    vertex::with_id< 40U>( 1.0, 97.0, 18.0, 46.0),
-    vertex::with_id< 41U>(88.0, 62.0, 95.0, 83.0),
-    vertex::with_id< 42U>(41.0,  8.0,  9.0, 51.0),
-    vertex::with_id< 43U>(85.0, 69.0, 84.0, 74.0),
-    vertex::with_id< 44U>(79.0, 95.0, 67.0, 49.0),
-    vertex::with_id< 45U>(59.0, 10.0, 41.0, 30.0),
-    vertex::with_id< 46U>(17.0, 26.0, 36.0, 48.0),
-    vertex::with_id< 47U>(74.0, 20.0, 50.0, 16.0),
-    vertex::with_id< 48U>(53.0, 25.0, 57.0, 33.0),
-    vertex::with_id< 49U>( 1.0,  1.0, 30.0, 43.0),
-    vertex::with_id< 50U>(36.0, 50.0,  6.0, 43.0),
-    vertex::with_id< 51U>(74.0, 32.0, 91.0, 41.0),
-    vertex::with_id< 52U>(94.0, 75.0, 88.0, 57.0),
-    vertex::with_id< 53U>(94.0, 24.0, 75.0, 85.0),
-    vertex::with_id< 54U>( 8.0, 43.0, 84.0, 24.0),
-    vertex::with_id< 55U>( 3.0, 47.0, 71.0, 25.0),
-    vertex::with_id< 56U>(67.0, 80.0, 37.0, 63.0),
-    vertex::with_id< 57U>(51.0, 33.0, 54.0, 60.0),
-    vertex::with_id< 58U>(57.0, 66.0,  2.0, 91.0),
-    vertex::with_id< 59U>(77.0, 45.0, 93.0, 45.0),
-    vertex::with_id< 60U>(50.0, 69.0, 24.0, 78.0),
-    vertex::with_id< 61U>( 8.0,  3.0, 23.0, 26.0),
-    vertex::with_id< 62U>(90.0, 76.0, 55.0, 80.0),
-    vertex::with_id< 63U>(16.0, 96.0, 72.0,  4.0),
-    vertex::with_id< 64U>(21.0, 99.0, 76.0, 52.0),
-    vertex::with_id< 65U>(34.0, 19.0, 16.0,  8.0),
-    vertex::with_id< 66U>(28.0, 71.0, 47.0, 25.0),
-    vertex::with_id< 67U>(50.0,  5.0, 71.0, 70.0),
-    vertex::with_id< 68U>(95.0, 56.0, 59.0, 88.0),
-    vertex::with_id< 69U>(64.0, 91.0, 19.0, 58.0),
-    vertex::with_id< 70U>(16.0, 36.0, 63.0, 67.0),
-    vertex::with_id< 71U>(88.0, 28.0, 22.0, 39.0),
-    vertex::with_id< 72U>(11.0, 62.0, 48.0, 12.0),
-    vertex::with_id< 73U>(63.0, 90.0, 73.0, 89.0),
-    vertex::with_id< 74U>(79.0, 95.0,  9.0, 52.0),
-    vertex::with_id< 75U>(92.0, 63.0, 81.0, 65.0),
-    vertex::with_id< 76U>(94.0, 42.0, 70.0, 60.0),
-    vertex::with_id< 77U>(23.0, 97.0, 94.0, 68.0),
-    vertex::with_id< 78U>( 1.0, 75.0, 67.0, 50.0),
-    vertex::with_id< 79U>(57.0, 64.0, 26.0, 93.0),
-    vertex::with_id< 80U>( 7.0, 57.0, 48.0, 17.0),
-    vertex::with_id< 81U>(49.0, 56.0, 81.0, 86.0),
-    vertex::with_id< 82U>(57.0, 49.0, 14.0, 74.0),
-    vertex::with_id< 83U>(83.0, 46.0, 76.0, 33.0),
-    vertex::with_id< 84U>(91.0, 46.0, 89.0, 87.0),
-    vertex::with_id< 85U>(88.0, 35.0, 15.0, 30.0),
-    vertex::with_id< 86U>(77.0,  8.0, 20.0, 26.0),
-    vertex::with_id< 87U>(42.0, 35.0, 64.0,  1.0),
-    vertex::with_id< 88U>(96.0, 70.0, 47.0, 39.0),
-    vertex::with_id< 89U>(70.0, 29.0,  8.0,  3.0),
-    vertex::with_id< 90U>(95.0,  8.0, 24.0, 47.0),
-    vertex::with_id< 91U>(40.0, 40.0, 45.0, 57.0),
-    vertex::with_id< 92U>(35.0,  6.0, 38.0, 25.0),
-    vertex::with_id< 93U>(98.0, 87.0, 39.0, 43.0),
-    vertex::with_id< 94U>(28.0,  9.0, 46.0, 47.0),
-    vertex::with_id< 95U>( 2.0, 99.0, 76.0, 60.0),
-    vertex::with_id< 96U>(91.0, 60.0, 23.0, 70.0),
-    vertex::with_id< 97U>(38.0, 33.0, 53.0, 79.0),
-    vertex::with_id< 98U>( 5.0, 32.0, 13.0, 71.0),
-    vertex::with_id< 99U>(81.0, 15.0,  6.0, 39.0),
-    vertex::with_id<100U>( 9.0, 66.0, 38.0, 26.0),
-    vertex::with_id<101U>(96.0,  7.0, 46.0, 65.0),
-    vertex::with_id<102U>(83.0, 38.0, 14.0, 77.0),
-    vertex::with_id<103U>( 2.0, 67.0, 95.0, 38.0),
-    vertex::with_id<104U>(32.0, 17.0, 86.0, 46.0),
-    vertex::with_id<105U>(18.0, 45.0, 24.0,  9.0),
-    vertex::with_id<106U>(94.0, 91.0, 80.0, 99.0),
-    vertex::with_id<107U>(36.0, 79.0, 47.0, 38.0),
-    vertex::with_id<108U>(68.0, 98.0, 50.0, 23.0),
-    vertex::with_id<109U>(83.0, 63.0, 73.0, 40.0),
-    vertex::with_id<110U>(74.0,  0.0, 76.0, 30.0),
-    vertex::with_id<111U>(54.0, 89.0, 94.0, 85.0),
-    vertex::with_id<112U>(69.0, 72.0, 56.0, 65.0),
-    vertex::with_id<113U>(40.0, 58.0, 70.0, 75.0),
-    vertex::with_id<114U>(50.0, 76.0, 85.0, 12.0),
-    vertex::with_id<115U>(31.0, 68.0, 29.0, 60.0),
-    vertex::with_id<116U>(66.0, 75.0, 11.0, 93.0),
-    vertex::with_id<117U>(50.0, 20.0, 68.0, 20.0),
-    vertex::with_id<118U>(46.0, 19.0, 78.0, 29.0),
-    vertex::with_id<119U>(39.0,  8.0, 84.0, 68.0),
-    vertex::with_id<120U>(24.0, 86.0, 50.0, 11.0),
-    vertex::with_id<121U>(41.0, 39.0, 13.0, 99.0),
-    vertex::with_id<122U>(78.0, 69.0, 12.0, 25.0),
-    vertex::with_id<123U>(97.0, 48.0,  3.0, 92.0),
-    vertex::with_id<124U>(58.0, 62.0, 96.0, 76.0),
-    vertex::with_id<125U>(76.0, 47.0, 53.0, 77.0),
-    vertex::with_id<126U>(39.0, 11.0, 35.0, 92.0),
-    vertex::with_id<127U>( 9.0, 98.0, 76.0, 55.0),
-    vertex::with_id<128U>(48.0, 84.0, 27.0, 32.0),
-    vertex::with_id<129U>(61.0,  2.0, 30.0, 84.0),
-    vertex::with_id<130U>(99.0, 25.0, 13.0, 44.0),
-    vertex::with_id<131U>(65.0, 34.0, 29.0, 12.0),
-    vertex::with_id<132U>(66.0, 70.0, 54.0, 92.0),
-    vertex::with_id<133U>(51.0, 15.0, 66.0, 49.0),
-    vertex::with_id<134U>(98.0, 17.0,  8.0, 70.0),
-    vertex::with_id<135U>(86.0, 99.0, 99.0, 73.0),
-    vertex::with_id<136U>( 3.0, 42.0, 69.0, 93.0),
-    vertex::with_id<137U>(20.0, 51.0, 34.0, 61.0),
-    vertex::with_id<138U>(53.0, 10.0,  6.0, 16.0),
-    vertex::with_id<139U>( 5.0,  3.0, 91.0, 50.0),
-    vertex::with_id<140U>(92.0, 29.0, 38.0, 18.0),
-    vertex::with_id<141U>( 6.0, 53.0, 26.0, 88.0),
-    vertex::with_id<142U>(68.0, 21.0, 73.0,  0.0),
-    vertex::with_id<143U>( 8.0,  3.0,  5.0, 92.0),
-    vertex::with_id<144U>(85.0, 29.0,  4.0, 38.0),
-    vertex::with_id<145U>(36.0, 58.0, 33.0,  8.0),
-    vertex::with_id<146U>(41.0,  8.0, 38.0, 27.0),
-    vertex::with_id<147U>(64.0, 28.0, 61.0, 19.0),
-    vertex::with_id<148U>(36.0, 71.0,  5.0, 99.0),
-    vertex::with_id<149U>(76.0, 89.0, 19.0, 63.0),
-    vertex::with_id<150U>(63.0, 81.0, 31.0, 59.0),
-    vertex::with_id<151U>(94.0, 10.0, 52.0, 57.0),
-    vertex::with_id<152U>(95.0,  4.0, 29.0, 44.0),
-    vertex::with_id<153U>(67.0,  5.0, 23.0,  7.0),
-    vertex::with_id<154U>(21.0, 70.0,  3.0, 49.0),
-    vertex::with_id<155U>(44.0, 13.0, 14.0, 70.0),
-    vertex::with_id<156U>(95.0, 24.0, 14.0, 19.0),
-    vertex::with_id<157U>(29.0, 33.0, 84.0, 49.0),
-    vertex::with_id<158U>(63.0,  8.0, 18.0, 95.0),
-    vertex::with_id<159U>( 6.0, 66.0, 59.0, 70.0),
-    vertex::with_id<160U>(23.0,  6.0, 47.0, 83.0),
-    vertex::with_id<161U>(16.0, 78.0, 50.0, 70.0),
-    vertex::with_id<162U>(98.0, 31.0,  4.0, 19.0),
-    vertex::with_id<163U>(63.0,  3.0, 59.0, 64.0),
-    vertex::with_id<164U>(69.0, 89.0, 91.0, 58.0),
-    vertex::with_id<165U>(59.0, 49.0, 56.0, 39.0),
-    vertex::with_id<166U>( 2.0, 27.0, 92.0, 33.0),
-    vertex::with_id<167U>(63.0, 19.0, 31.0,  2.0),
-    vertex::with_id<168U>( 9.0, 89.0, 49.0, 51.0),
-    vertex::with_id<169U>(66.0, 52.0, 29.0, 22.0),
-    vertex::with_id<170U>(20.0, 94.0, 71.0, 32.0),
-    vertex::with_id<171U>( 5.0, 77.0, 39.0, 82.0),
-    vertex::with_id<172U>(23.0, 98.0, 31.0, 61.0),
-    vertex::with_id<173U>(10.0, 49.0, 80.0, 50.0),
-    vertex::with_id<174U>(86.0, 14.0, 52.0, 64.0),
-    vertex::with_id<175U>(68.0, 62.0, 16.0, 90.0),
-    vertex::with_id<176U>( 3.0, 67.0, 20.0,  2.0),
-    vertex::with_id<177U>(63.0, 70.0, 41.0, 95.0),
-    vertex::with_id<178U>(99.0, 99.0, 46.0, 73.0),
-    vertex::with_id<179U>(55.0, 97.0, 82.0, 12.0),
-    vertex::with_id<180U>( 9.0, 84.0, 72.0, 85.0),
-    vertex::with_id<181U>(65.0, 73.0, 36.0,  3.0),
-    vertex::with_id<182U>(57.0, 11.0, 55.0, 67.0),
-    vertex::with_id<183U>(62.0, 82.0, 76.0, 46.0),
-    vertex::with_id<184U>(68.0, 25.0,  5.0, 72.0),
-    vertex::with_id<185U>( 5.0, 69.0, 63.0, 21.0),
-    vertex::with_id<186U>(69.0,  0.0, 85.0, 96.0),
-    vertex::with_id<187U>(56.0, 75.0, 96.0, 75.0),
-    vertex::with_id<188U>(32.0, 72.0, 37.0, 46.0),
-    vertex::with_id<189U>(15.0, 27.0, 98.0, 81.0),
-    vertex::with_id<190U>(87.0, 81.0, 37.0, 32.0),
-    vertex::with_id<191U>(21.0, 56.0, 54.0, 48.0),
-    vertex::with_id<192U>(53.0, 94.0, 40.0, 61.0),
-    vertex::with_id<193U>(79.0,  6.0, 99.0, 98.0),
-    vertex::with_id<194U>(49.0, 68.0, 49.0, 83.0),
-    vertex::with_id<195U>(47.0, 28.0, 81.0, 23.0),
-    vertex::with_id<196U>(47.0, 13.0, 12.0, 77.0),
-    vertex::with_id<197U>(34.0,  7.0, 91.0, 18.0),
-    vertex::with_id<198U>(74.0, 69.0, 23.0, 82.0),
-    vertex::with_id<199U>(10.0, 89.0, 63.0, 63.0),
-    vertex::with_id<200U>(54.0, 23.0, 29.0, 66.0),
-    vertex::with_id<201U>( 4.0, 36.0, 89.0, 29.0),
-    vertex::with_id<202U>(33.0, 73.0, 62.0, 53.0),
-    vertex::with_id<203U>(29.0, 40.0, 27.0, 72.0),
-    vertex::with_id<204U>(61.0, 73.0, 13.0, 37.0),
-    vertex::with_id<205U>( 8.0,  4.0, 16.0, 81.0),
-    vertex::with_id<206U>( 8.0, 24.0, 53.0, 59.0),
-    vertex::with_id<207U>(77.0, 50.0, 31.0, 59.0),
-    vertex::with_id<208U>(25.0, 40.0, 22.0, 91.0),
-    vertex::with_id<209U>(73.0, 89.0, 79.0, 71.0),
-    vertex::with_id<210U>(11.0, 83.0, 77.0, 33.0),
-    vertex::with_id<211U>(51.0, 59.0, 97.0, 88.0),
-    vertex::with_id<212U>( 4.0, 48.0, 16.0, 72.0),
-    vertex::with_id<213U>(93.0, 61.0,  6.0, 32.0),
-    vertex::with_id<214U>(40.0, 54.0, 85.0, 61.0),
-    vertex::with_id<215U>(56.0, 94.0, 96.0, 26.0),
-    vertex::with_id<216U>(12.0, 23.0, 49.0, 65.0),
-    vertex::with_id<217U>(78.0, 49.0, 68.0, 28.0),
-    vertex::with_id<218U>(14.0, 94.0, 33.0, 72.0),
-    vertex::with_id<219U>(45.0, 55.0, 22.0,  3.0),
-    vertex::with_id<220U>(75.0, 78.0,  1.0,  2.0),
-    vertex::with_id<221U>(43.0, 84.0, 84.0, 26.0),
-    vertex::with_id<222U>( 8.0, 63.0, 29.0, 72.0),
-    vertex::with_id<223U>(73.0, 87.0, 88.0, 69.0),
-    vertex::with_id<224U>(18.0, 28.0, 22.0, 24.0),
-    vertex::with_id<225U>( 9.0, 97.0, 70.0, 74.0),
-    vertex::with_id<226U>(53.0, 46.0, 37.0, 15.0),
-    vertex::with_id<227U>(36.0, 75.0, 83.0, 61.0),
-    vertex::with_id<228U>(20.0,  0.0, 58.0, 51.0),
-    vertex::with_id<229U>(24.0, 47.0, 73.0, 25.0),
-    vertex::with_id<230U>(67.0, 44.0,  9.0, 33.0),
-    vertex::with_id<231U>(31.0, 12.0, 63.0, 98.0),
-    vertex::with_id<232U>(41.0, 14.0, 54.0, 17.0),
-    vertex::with_id<233U>(17.0,  0.0, 87.0, 12.0),
-    vertex::with_id<234U>(22.0,  5.0, 75.0, 53.0),
-    vertex::with_id<235U>(24.0, 36.0, 47.0, 22.0),
-    vertex::with_id<236U>( 9.0, 90.0, 95.0, 84.0),
-    vertex::with_id<237U>(95.0, 51.0, 54.0, 81.0),
-    vertex::with_id<238U>(80.0, 17.0, 97.0, 99.0),
-    vertex::with_id<239U>(76.0, 11.0, 69.0, 96.0),
-    vertex::with_id<240U>(69.0, 40.0, 84.0, 80.0),
-    vertex::with_id<241U>(83.0, 68.0, 95.0, 84.0),
-    vertex::with_id<242U>(43.0, 71.0, 90.0, 95.0),
-    vertex::with_id<243U>(25.0, 94.0, 41.0, 48.0),
-    vertex::with_id<244U>(94.0, 65.0, 28.0, 58.0),
-    vertex::with_id<245U>(50.0, 63.0,  6.0, 86.0),
-    vertex::with_id<246U>(28.0, 28.0, 86.0, 29.0),
-    vertex::with_id<247U>(71.0, 84.0, 79.0, 82.0),
-    vertex::with_id<248U>(18.0,  4.0, 54.0, 70.0),
-    vertex::with_id<249U>(83.0, 72.0, 55.0, 13.0),
-    vertex::with_id<250U>(47.0, 55.0, 92.0, 71.0),
+
+/**
+ * The default instance, `coordenadas.txt` parsed by the compiler. The makefile wraps the file
+ * in a raw string literal as `coordenadas.inc`, so changing the instance only needs a rebuild.
+ */
+namespace embedded {
+    inline constexpr std::string_view text =
+#include "coordenadas.inc"
+    ;
+
+    [[gnu::const]]
+    constexpr inline bool blank(char c) noexcept {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    /** Number of lines with anything besides blanks. */
+    consteval size_t count(std::string_view text) {
+        size_t lines = 0;
+        bool filled = false;
+        for (const char c : text) {
+            if (c == '\n') {
+                lines += filled;
+                filled = false;
+            } else if (!blank(c)) {
+                filled = true;
+            }
+        }
+        return lines + filled;
+    }
+
+    /** Parses the plain decimal at `pos`, moving past it. Anything else fails the build. */
+    consteval double number(std::string_view text, size_t& pos) {
+        while (pos < text.size() && blank(text[pos])) {
+            pos++;
+        }
+        const bool negative = pos < text.size() && text[pos] == '-';
+        pos += negative;
+
+        const size_t start = pos;
+        double value = 0.0;
+        while (pos < text.size() && unsigned(text[pos] - '0') < 10) {
+            value = 10.0 * value + (text[pos++] - '0');
+        }
+        if (pos < text.size() && text[pos] == '.') {
+            double scale = 0.1;
+            for (pos++; pos < text.size() && unsigned(text[pos] - '0') < 10; pos++, scale /= 10.0) {
+                value += scale * (text[pos] - '0');
+            }
+        }
+        if (pos == start) {
+            throw "coordenadas.txt: expected a number";
+        }
+        return negative ? -value : value;
+    }
+
+    /** The `N` vertices of `text`, one `x1 y1 x2 y2` line each, with ids from one. */
+    template <size_t N>
+    consteval std::array<vertex, N> parse(std::string_view text) {
+        auto vertices = std::array<vertex, N>();
+        size_t pos = 0;
+        for (unsigned v = 0; v < N; v++) {
+            while (pos < text.size() && (blank(text[pos]) || text[pos] == '\n')) {
+                pos++;
+            }
+            double coords[4] = {};
+            for (double& coord : coords) {
+                coord = number(text, pos);
+            }
+            while (pos < text.size() && blank(text[pos])) {
+                pos++;
+            }
+            if (pos < text.size() && text[pos] != '\n') {
+                throw "coordenadas.txt: expected four numbers per line";
+            }
+            vertices[v] = vertex::with_id(v + 1, coords[0], coords[1], coords[2], coords[3]);
+        }
+        return vertices;
+    }
+
+    /** Every edge cost of space `i`, row by row, packed as 16-bit integers. */
+    template <size_t N>
+    consteval std::array<uint16_t, N * N> costs(const std::array<vertex, N>& vertices, uint8_t i) {
+        auto table = std::array<uint16_t, N * N>();
+        for (size_t u = 0; u < N; u++) {
+            for (size_t v = 0; v < N; v++) {
+                const double cost = vertices[u][i].template cost<metric::ceil_2d>(vertices[v][i]);
+                if (cost < 0.0 || cost > 65535.0 || cost != uint16_t(cost)) {
+                    throw "coordenadas.txt: edge costs must be integers in 16 bits";
+                }
+                table[u * N + v] = uint16_t(cost);
+            }
+        }
+        return table;
+    }
+}
+
+
+static constexpr std::array<vertex, embedded::count(embedded::text)> DEFAULT_VERTICES =
+    embedded::parse<embedded::count(embedded::text)>(embedded::text);
+
+/** Edge costs of `DEFAULT_VERTICES` in each space, computed at compile time. */
+static constexpr utils::pair<std::array<uint16_t, DEFAULT_VERTICES.size() * DEFAULT_VERTICES.size()>> DEFAULT_COSTS = {
+    embedded::costs(DEFAULT_VERTICES, 0),
+    embedded::costs(DEFAULT_VERTICES, 1),
 };
@@ -1,15 +1,22 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <chrono>
 #include <concepts>
 #include <functional>
+#include <optional>
 #include <span>
+#include <utility>
 #include <vector>
 
 #include <gurobi_c++.h>
 #include "vertex.hpp"
 #include "tour.hpp"
+#include "polish.hpp"
+#include "patch.hpp"
+#include "progress.hpp"
+#include "checkpoint.hpp"
 
 
 namespace utils {
@@ -37,49 +44,334 @@ namespace utils {
         const auto solutions = get_solutions(vertices.size(), get_solution);
         return tour::min_sub_tour(vertices, solutions);
     }
+
+    /** Edges a reduced model of `M` tours is built over, for each tour, and the ones forced into it. */
+    template <size_t M>
+    struct basic_edge_filter final {
+    public:
+        group<matrix<bool>, M> allowed;
+        group<matrix<bool>, M> forced;
+
+        /** Every edge over `n` vertices allowed in every tour, none forced. */
+        [[gnu::cold]]
+        static basic_edge_filter every(size_t n) {
+            auto filter = [n]<size_t... I>(std::index_sequence<I...>) {
+                return basic_edge_filter { { ((void) I, matrix<bool>(n))... }, { ((void) I, matrix<bool>(n))... } };
+            }(std::make_index_sequence<M>());
+
+            for (uint8_t i = 0; i < M; i++) {
+                std::fill_n(filter.allowed[i][0].data(), filter.allowed[i].total(), true);
+                std::fill_n(filter.forced[i][0].data(), filter.forced[i].total(), false);
+                for (unsigned v = 0; v < n; v++) {
+                    filter.allowed[i][v][v] = false;
+                }
+            }
+            return filter;
+        }
+    };
+
+    using edge_filter = basic_edge_filter<2>;
+
+    /** If the variable for `(u, v)` in tour `i` exists, which is always the case without a filter. */
+    template <size_t M>
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    static inline bool available(const std::optional<basic_edge_filter<M>>& filter, uint8_t i, unsigned u, unsigned v) noexcept {
+        return !filter || filter->allowed[i][u][v];
+    }
+
+    /** How the `k` shared edges are counted once there are more than two tours. */
+    enum class sharing : uint8_t {
+        /** Every two tours share at least `k` edges, one quadratic constraint per pair. */
+        pairwise,
+        /** At least `k` edges are in every tour, linear through one bound variable per edge. */
+        common,
+    };
 }
 
+/**
+ * Separates the subtours of each of the `M` tours on every integer solution. With a pair of
+ * tours in spaces 0 and 1, it also turns the solutions it accepts or rejects into polished
+ * pairs for the solver.
+ */
+template <typename Metric, size_t M = 2>
 struct subtour_elim final : public GRBCallback {
 public:
     const std::span<const vertex> vertices;
-    const  utils::pair<utils::matrix<GRBVar>>& vars;
+    const utils::group<uint8_t, M> spaces;
+    const utils::group<utils::matrix<GRBVar>, M>& vars;
+    const std::optional<utils::basic_edge_filter<M>>& filter;
+    const unsigned k;
 
-    [[gnu::cold]] [[gnu::nothrow]]
-    inline subtour_elim(std::span<const vertex> vertices, const utils::pair<utils::matrix<GRBVar>>& vars) noexcept:
-        GRBCallback(), vertices(vertices), vars(vars)
-    { }
+    utils::polish_stats polishing;
+    utils::patch_stats patching;
+    /** Subtour elimination constraints added. */
+    int64_t lazy = 0;
+    /** Cutting planes applied by the solver, as of the last progress event. */
+    int64_t cuts = 0;
+
+    /** Candidate lists are built here, once, since the polish runs on every incumbent. */
+    [[gnu::cold]]
+    inline subtour_elim(
+        std::span<const vertex> vertices,
+        const utils::group<uint8_t, M>& spaces,
+        const utils::group<utils::matrix<GRBVar>, M>& vars,
+        const std::optional<utils::basic_edge_filter<M>>& filter,
+        unsigned k,
+        progress_log *log = nullptr,
+        checkpointer *saving = nullptr,
+        utils::deadline stop = utils::deadline()
+    ):
+        GRBCallback(), vertices(vertices), spaces(spaces), vars(vars), filter(filter), k(k), coords(vertices),
+        log(log), saving(saving), stop(stop)
+    {
+        if (paired(spaces)) [[likely]] {
+            this->near.emplace(utils::pair<neighbors> { neighbors::nearest<Metric>(this->coords[0]), neighbors::nearest<Metric>(this->coords[1]) });
+        }
+    }
+
+    /** If the tours are a pair in spaces 0 and 1, which the polish, the patching and the checkpoints need. */
+    [[gnu::const]] [[gnu::cold]] [[gnu::nothrow]]
+    static constexpr bool paired(const utils::group<uint8_t, M>& spaces) noexcept {
+        if constexpr (M == 2) {
+            return spaces[0] == 0 && spaces[1] == 1;
+        } else {
+            return false;
+        }
+    }
 
 private:
+    /** Coordinates of both spaces and their candidate lists, only for a pair, for the polish. */
+    const utils::columns coords;
+    std::optional<utils::pair<neighbors>> near;
+
+    /** Heuristic tour pair waiting for the next MIPNODE. */
+    struct candidate final {
+        utils::group<tour, M> tours;
+        double cost;
+        bool patched;
+    };
+
+    std::optional<candidate> pending;
+    progress_log *log;
+    checkpointer *saving;
+    const utils::deadline stop;
+
     [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
     inline size_t count() const noexcept {
         return this->vertices.size();
     }
 
     [[gnu::hot]]
-    inline void lazy_constraint_subtour_elimination(uint8_t i) {
-        auto tour = utils::min_sub_tour(this->vertices, [this, i](unsigned u, unsigned v) {
-            return this->getSolution(this->vars[i][u][v]) > 0.5;
+    inline std::vector<tour> sub_tours(uint8_t i) {
+        const auto solutions = utils::get_solutions(this->count(), [this, i](unsigned u, unsigned v) {
+            return utils::available(this->filter, i, u, v) && this->getSolution(this->vars[i][u][v]) > 0.5;
         });
+        return tour::sub_tours(this->vertices, solutions);
+    }
 
-        if (tour.size() >= this->count()) [[unlikely]] {
-            return;
+    /** Adds the cut for the smallest cycle in `cycles` if there is more than one, returning if it did. */
+    [[gnu::hot]]
+    inline bool lazy_constraint_subtour_elimination(uint8_t i, const std::vector<tour>& cycles) {
+        if (cycles.size() <= 1) [[unlikely]] {
+            return false;
         }
+        const auto& tour = *std::min_element(cycles.begin(), cycles.end(), [](const auto& a, const auto& b) {
+            return a.size() < b.size();
+        });
 
         auto expr = GRBLinExpr();
         for (unsigned u = 0; u < tour.size(); u++) {
             for (unsigned v = u + 1; v < tour.size(); v++) {
-                expr += this->vars[i][tour[u]][tour[v]];
+                if (utils::available(this->filter, i, tour[u], tour[v])) [[likely]] {
+                    expr += this->vars[i][tour[u]][tour[v]];
+                }
             }
         }
         this->addLazy(expr, GRB_LESS_EQUAL, tour.size()-1);
+        this->lazy += 1;
+        if (this->saving) [[unlikely]] {
+            this->saving->cut(i, tour);
+        }
+        return true;
+    }
+
+    [[gnu::pure]] [[gnu::hot]]
+    inline double cost(const utils::group<tour, M>& tours) const noexcept {
+        double total = 0.0;
+        for (uint8_t i = 0; i < M; i++) {
+            total += tours[i].template cost<Metric>(this->spaces[i], this->vertices);
+        }
+        return total;
+    }
+
+    [[gnu::hot]]
+    inline void enqueue(const utils::group<tour, M>& tours, double cost, bool patched) {
+        if (!this->pending || cost < this->pending->cost) [[likely]] {
+            this->pending = candidate { tours, cost, patched };
+        }
+    }
+
+    [[gnu::hot]]
+    inline void polish_incumbent(const utils::pair<tour>& tours) {
+        const double cost = this->getDoubleInfo(GRB_CB_MIPSOL_OBJ);
+
+        const auto polished = polish<Metric>::improve(this->coords, *this->near, this->k, tours, this->stop);
+        if (!polished) [[likely]] {
+            this->polishing.record(0.0);
+            return;
+        }
+
+        const double new_cost = this->cost(*polished);
+        this->polishing.record(cost - new_cost);
+        this->enqueue(*polished, new_cost, false);
+    }
+
+    /**
+     * Patches each 2-factor into a tour and, if they no longer share `k` edges, replaces
+     * both by whichever of them is cheaper in the two spaces before polishing the pair.
+     */
+    [[gnu::hot]]
+    inline void repair_rejected(utils::pair<std::vector<tour>>& cycles) {
+        this->patching.rejected += 1;
+
+        auto tours = utils::pair<tour> {
+            patch<Metric>::join(this->coords, 0, std::move(cycles[0])),
+            patch<Metric>::join(this->coords, 1, std::move(cycles[1])),
+        };
+
+        if (patch<Metric>::make_similar(this->coords, this->k, tours)) [[unlikely]] {
+            this->patching.restored += 1;
+        }
+
+        if (auto polished = polish<Metric>::improve(this->coords, *this->near, this->k, tours, this->stop)) [[likely]] {
+            tours = std::move(*polished);
+        }
+        this->enqueue(tours, this->cost(tours), true);
+    }
+
+    /** If every edge of `tours` has a variable and every forced edge is used, so they can be injected. */
+    [[gnu::pure]] [[gnu::hot]]
+    inline bool fits_filter(const utils::group<tour, M>& tours) const {
+        if (!this->filter) [[likely]] {
+            return true;
+        }
+        const size_t n = this->count();
+        for (uint8_t i = 0; i < M; i++) {
+            const auto edges = tours[i].edges(n);
+            for (unsigned u = 0; u < n; u++) {
+                for (unsigned v = u + 1; v < n; v++) {
+                    if (edges[u][v] ? !this->filter->allowed[i][u][v] : this->filter->forced[i][u][v]) {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    [[gnu::hot]]
+    inline void inject_pending() {
+        const auto [tours, cost, patched] = *this->pending;
+        this->pending = std::nullopt;
+
+        if (cost >= this->getDoubleInfo(GRB_CB_MIPNODE_OBJBST) - 0.5) [[unlikely]] {
+            return;
+        }
+
+        const size_t n = this->count();
+        if (!this->fits_filter(tours)) [[unlikely]] {
+            return;
+        }
+        for (uint8_t i = 0; i < M; i++) {
+            const auto edges = tours[i].edges(n);
+
+            for (unsigned u = 0; u < n; u++) {
+                for (unsigned v = u + 1; v < n; v++) {
+                    if (utils::available(this->filter, i, u, v)) [[likely]] {
+                        this->setSolution(this->vars[i][u][v], edges[u][v] ? 1.0 : 0.0);
+                    }
+                }
+            }
+        }
+        this->useSolution();
+
+        if (patched) {
+            this->patching.injected += 1;
+        } else {
+            this->polishing.injected += 1;
+        }
+    }
+
+    /** Checks the clock on every MIP callback, but only queries the rest when an event is due. */
+    [[gnu::hot]]
+    inline void log_progress() {
+        const double time = this->getDoubleInfo(GRB_CB_RUNTIME);
+        if (!this->log->due(time)) [[likely]] {
+            return;
+        }
+
+        this->cuts = this->getIntInfo(GRB_CB_MIP_CUTCNT);
+        this->log->progress({
+            time,
+            this->getDoubleInfo(GRB_CB_MIP_OBJBST),
+            this->getDoubleInfo(GRB_CB_MIP_OBJBND),
+            this->getDoubleInfo(GRB_CB_MIP_NODCNT),
+            this->cuts,
+            this->lazy,
+        });
+    }
+
+    [[gnu::hot]]
+    inline void log_incumbent() {
+        this->log->incumbent({
+            this->getDoubleInfo(GRB_CB_RUNTIME),
+            std::min(this->getDoubleInfo(GRB_CB_MIPSOL_OBJ), this->getDoubleInfo(GRB_CB_MIPSOL_OBJBST)),
+            this->getDoubleInfo(GRB_CB_MIPSOL_OBJBND),
+            this->getDoubleInfo(GRB_CB_MIPSOL_NODCNT),
+            this->cuts,
+            this->lazy,
+        });
     }
 
 protected:
     [[gnu::hot]]
     void callback() {
         if (this->where == GRB_CB_MIPSOL) [[likely]] {
-            this->lazy_constraint_subtour_elimination(0);
-            this->lazy_constraint_subtour_elimination(1);
+            auto cycles = utils::group<std::vector<tour>, M>();
+            bool cut = false;
+            for (uint8_t i = 0; i < M; i++) {
+                cycles[i] = this->sub_tours(i);
+                cut |= this->lazy_constraint_subtour_elimination(i, cycles[i]);
+            }
+
+            if (!cut && this->log) [[unlikely]] {
+                this->log_incumbent();
+            }
+            // the checkpoints, the polish and the patching all work on pairs of tours
+            if constexpr (M == 2) {
+                if (!this->near) [[unlikely]] {
+                    return;
+                }
+                if (!cut) {
+                    if (this->saving) [[unlikely]] {
+                        this->saving->incumbent({ cycles[0].front(), cycles[1].front() }, this->getDoubleInfo(GRB_CB_MIPSOL_OBJ));
+                    }
+                    this->polish_incumbent({ cycles[0].front(), cycles[1].front() });
+                } else {
+                    this->repair_rejected(cycles);
+                }
+            }
+
+        } else if (this->where == GRB_CB_MIPNODE && this->pending) [[unlikely]] {
+            this->inject_pending();
+
+        } else if (this->where == GRB_CB_MIP) {
+            if (this->log) [[unlikely]] {
+                this->log_progress();
+            }
+            if (this->saving) [[unlikely]] {
+                this->saving->tick(this->getDoubleInfo(GRB_CB_RUNTIME));
+            }
         }
     }
 };
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "vertex.hpp"
+
+
+namespace utils {
+    /** How the generated points spread over the square of each space. */
+    enum class distribution : uint8_t {
+        /** Independent and uniform in both spaces. */
+        uniform,
+        /** Normal around a few uniform centers, in each space on its own. */
+        clustered,
+        /** Uniform in the first space, and the second a blend of it with independent uniform noise. */
+        correlated,
+    };
+}
+
+
+/**
+ * Seeded random paired instances. Every coordinate is a hash of the seed, the vertex and the
+ * coordinate, so there is no generator state between vertices: the loop has no dependencies,
+ * the same seed gives the same points for any prefix, and a million vertices take some 30 ms.
+ * Coordinates are integral, in a square that grows with `sqrt(n)` to keep the density of the
+ * 250 embedded vertices in their 100 by 100 square.
+ */
+struct generator final {
+private:
+    /** Values drawn for each vertex: one per coordinate, and one per space to pick a cluster. */
+    static constexpr uint64_t streams = 6;
+
+    uint64_t key;
+
+    /** SplitMix64 finalizer, a bijection with good avalanche on consecutive counters. */
+    [[gnu::const]] [[gnu::hot]] [[gnu::nothrow]]
+    static constexpr inline uint64_t mix(uint64_t z) noexcept {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9U;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebU;
+        return z ^ (z >> 31);
+    }
+
+    /** Uniform in [0, 1) from the `stream`-th value of vertex `v`. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline double unit(uint64_t v, uint64_t stream) const noexcept {
+        const uint64_t bits = mix(this->key + (v * streams + stream) * 0x9e3779b97f4a7c15U);
+        return double(bits >> 11) * 0x1.0p-53;
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline double snap(double coord) const noexcept {
+        return std::clamp(std::floor(coord), 0.0, this->side - 1.0);
+    }
+
+    /** Point of space `i` of vertex `v`, uniform over the square. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline vertex::point uniform(uint64_t v, uint8_t i) const noexcept {
+        return vertex::point(this->snap(this->side * this->unit(v, 2 * i)), this->snap(this->side * this->unit(v, 2 * i + 1)));
+    }
+
+    /**
+     * Approximately standard normal from the `stream`-th value of vertex `v`, the sum of its four
+     * 16-bit quarters as uniforms (Irwin-Hall), without the logarithm and cosine of Box-Muller.
+     */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline double normal(uint64_t v, uint64_t stream) const noexcept {
+        const uint64_t bits = mix(this->key + (v * streams + stream) * 0x9e3779b97f4a7c15U);
+        const uint64_t sum = (bits & 0xffff) + ((bits >> 16) & 0xffff) + ((bits >> 32) & 0xffff) + (bits >> 48);
+        return (double(sum) * 0x1.0p-16 - 2.0) * std::numbers::sqrt3;
+    }
+
+    /** Point of space `i` of vertex `v`, normal around the center picked for it in that space. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline vertex::point clustered(uint64_t v, uint8_t i) const noexcept {
+        const uint64_t center = uint64_t(this->unit(v, 4 + i) * this->clusters);
+        // centers hash from counters at the top of the range, away from any vertex, so they never depend on `n`
+        const uint64_t c = ~center - i;
+        const double spread = this->side / (4.0 * std::sqrt(double(this->clusters)));
+
+        return vertex::point(
+            this->snap(this->side * this->unit(c, 0) + spread * this->normal(v, 2 * i)),
+            this->snap(this->side * this->unit(c, 1) + spread * this->normal(v, 2 * i + 1))
+        );
+    }
+
+    /** Point of the second space of vertex `v`, keeping `correlation` of its point in the first one. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline vertex::point correlated(uint64_t v, const vertex::point& first) const noexcept {
+        const auto noise = this->uniform(v, 1);
+        const double rho = this->correlation;
+        return vertex::point(this->snap(rho * first[0] + (1.0 - rho) * noise[0]), this->snap(rho * first[1] + (1.0 - rho) * noise[1]));
+    }
+
+    template <utils::distribution dist>
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline vertex make(uint64_t v) const noexcept {
+        if constexpr (dist == utils::distribution::clustered) {
+            const auto first = this->clustered(v, 0), second = this->clustered(v, 1);
+            return vertex::with_id(v + 1, first[0], first[1], second[0], second[1]);
+        } else if constexpr (dist == utils::distribution::correlated) {
+            const auto first = this->uniform(v, 0), second = this->correlated(v, first);
+            return vertex::with_id(v + 1, first[0], first[1], second[0], second[1]);
+        } else {
+            const auto first = this->uniform(v, 0), second = this->uniform(v, 1);
+            return vertex::with_id(v + 1, first[0], first[1], second[0], second[1]);
+        }
+    }
+
+    /** Fills `out` with the vertices from `offset`, with the distribution fixed out of the loop. */
+    template <utils::distribution dist>
+    [[gnu::hot]]
+    void fill(std::span<vertex> out, uint64_t offset = 0) const noexcept {
+        for (size_t v = 0; v < out.size(); v++) {
+            out[v] = this->make<dist>(offset + v);
+        }
+    }
+
+public:
+    [[gnu::cold]]
+    generator(size_t n, uint64_t seed, utils::distribution dist, double correlation = 0.5):
+        key(mix(seed)), n(n), dist(dist), correlation(std::clamp(correlation, 0.0, 1.0)),
+        side(std::max(100.0, std::round(100.0 * std::sqrt(n / 250.0)))),
+        clusters(std::max<size_t>(1, n / 100))
+    { }
+
+    const size_t n;
+    const utils::distribution dist;
+    /** How much of the first space the second one keeps, only for `correlated`. */
+    const double correlation;
+    /** Coordinates are in `[0, side)`. */
+    const double side;
+    /** Number of cluster centers in each space, only for `clustered`. */
+    const size_t clusters;
+
+    /** Vertex `v` alone, the same as in any generated prefix that contains it. */
+    [[gnu::pure]] [[gnu::hot]]
+    vertex operator()(uint64_t v) const noexcept {
+        auto one = vertex();
+        this->generate(std::span(&one, 1), v);
+        return one;
+    }
+
+    /** Vertices `offset` onwards into `out`, so several threads may fill disjoint ranges. */
+    [[gnu::hot]]
+    void generate(std::span<vertex> out, uint64_t offset = 0) const noexcept {
+        switch (this->dist) {
+            case utils::distribution::clustered:
+                return this->fill<utils::distribution::clustered>(out, offset);
+            case utils::distribution::correlated:
+                return this->fill<utils::distribution::correlated>(out, offset);
+            default:
+                return this->fill<utils::distribution::uniform>(out, offset);
+        }
+    }
+
+    [[gnu::hot]]
+    std::vector<vertex> generate() const {
+        auto vertices = std::vector<vertex>(this->n);
+        this->generate(vertices);
+        return vertices;
+    }
+
+    /** Reads `n,seed,dist` or `n,seed,correlated,rho`, throwing `std::invalid_argument` if malformed. */
+    [[gnu::cold]]
+    static generator from(std::string_view spec) {
+        auto fields = std::vector<std::string_view>();
+        for (size_t start = 0; start <= spec.size();) {
+            const size_t end = std::min(spec.find(',', start), spec.size());
+            fields.push_back(spec.substr(start, end - start));
+            start = end + 1;
+        }
+        const auto fail = [spec](const char *reason) {
+            return std::invalid_argument("--generate: " + std::string(reason) + " in '" + std::string(spec) + "'");
+        };
+        if (fields.size() < 3 || fields.size() > 4) [[unlikely]] {
+            throw fail("expected 'n,seed,dist' or 'n,seed,correlated,rho'");
+        }
+
+        size_t n = 0;
+        uint64_t seed = 0;
+        double rho = 0.5;
+        if (std::from_chars(fields[0].data(), fields[0].data() + fields[0].size(), n).ptr != fields[0].data() + fields[0].size() || n == 0) [[unlikely]] {
+            throw fail("invalid number of vertices");
+        }
+        if (std::from_chars(fields[1].data(), fields[1].data() + fields[1].size(), seed).ptr != fields[1].data() + fields[1].size()) [[unlikely]] {
+            throw fail("invalid seed");
+        }
+
+        auto dist = utils::distribution::uniform;
+        if (fields[2] == "clustered") {
+            dist = utils::distribution::clustered;
+        } else if (fields[2] == "correlated") {
+            dist = utils::distribution::correlated;
+        } else if (fields[2] != "uniform") [[unlikely]] {
+            throw fail("expected 'uniform', 'clustered' or 'correlated'");
+        }
+
+        if (fields.size() == 4) {
+            const auto res = std::from_chars(fields[3].data(), fields[3].data() + fields[3].size(), rho);
+            if (dist != utils::distribution::correlated || res.ptr != fields[3].data() + fields[3].size() || rho < 0.0 || rho > 1.0) [[unlikely]] {
+                throw fail("the correlation must be in [0, 1] and only follows 'correlated'");
+            }
+        }
+        return generator(n, seed, dist, rho);
+    }
+};
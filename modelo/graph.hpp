@@ -1,14 +1,22 @@
 #pragma once
 
+#include <algorithm>
+#include <bit>
 #include <chrono>
+#include <cstdint>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <optional>
 #include <span>
 #include <stdexcept>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include <gurobi_c++.h>
 #include "vertex.hpp"
+#include "instance.hpp"
 #include "elimination.hpp"
 
 
@@ -36,43 +44,118 @@ namespace utils {
         }
     };
 
-    [[gnu::cold]]
-    static std::string join(std::ranges::forward_range auto range, const std::string_view& sep) {
-        std::ostringstream buf;
-        bool first = true;
+    /** Edges of one tour over `n` vertices, one bit per pair `u < v`, row by row of the upper triangle. */
+    struct edge_bits final {
+    private:
+        size_t n;
+        std::vector<uint64_t> words;
+
+    public:
+        [[gnu::cold]]
+        explicit edge_bits(size_t n = 0): n(n), words((n * (n - 1) / 2 + 63) / 64, 0) { }
+
+        /** Bit of the edge `(u, v)`, for `u < v`. */
+        [[gnu::const]] [[gnu::hot]] [[gnu::nothrow]]
+        static constexpr inline size_t index(size_t n, size_t u, size_t v) noexcept {
+            return u * (2 * n - u - 1) / 2 + (v - u - 1);
+        }
+
+        [[gnu::hot]] [[gnu::nothrow]]
+        inline void insert(size_t bit) noexcept {
+            this->words[bit / 64] |= uint64_t(1) << (bit % 64);
+        }
 
-        for (const auto& item : range) {
-            if (!first) {
-                buf << sep;
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline bool contains(unsigned u, unsigned v) const noexcept {
+            if (u == v) [[unlikely]] {
+                return false;
             }
-            buf << item;
-            first = false;
+            const size_t bit = u < v ? index(this->n, u, v) : index(this->n, v, u);
+            return (this->words[bit / 64] >> (bit % 64)) & 1;
         }
-        return buf.str();
-    }
+
+        /** Keeps only the edges also in `other`. */
+        [[gnu::hot]] [[gnu::nothrow]]
+        inline edge_bits& operator&=(const edge_bits& other) noexcept {
+            for (size_t w = 0; w < this->words.size(); w++) {
+                this->words[w] &= other.words[w];
+            }
+            return *this;
+        }
+
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline unsigned count() const noexcept {
+            unsigned total = 0;
+            for (const uint64_t word : this->words) {
+                total += std::popcount(word);
+            }
+            return total;
+        }
+
+        [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+        inline std::span<const uint64_t> data() const noexcept {
+            return this->words;
+        }
+
+        /** Edges in both this and `other`. */
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline unsigned shared(const edge_bits& other) const noexcept {
+            unsigned total = 0;
+            for (size_t w = 0; w < this->words.size(); w++) {
+                total += std::popcount(this->words[w] & other.words[w]);
+            }
+            return total;
+        }
+    };
 }
 
 
+/**
+ * The exact model over `M` tours, tour `i` costed in space `spaces[i]` of the vertices, each
+ * `k`-similar to the others as counted by `sharing`. Several tours may share a space. The
+ * tour count is fixed at compile time, so every loop over the tours has a known trip count
+ * and every per tour member is a plain array.
+ */
+template <typename Metric, size_t M = 2>
 struct graph final {
 private:
+    static_assert(M >= 1, "a model needs at least one tour.");
+
     GRBModel model;
+    /** Only for reduced models, whose missing variables are fixed at zero. */
+    const std::optional<utils::basic_edge_filter<M>> filter;
+    progress_log *log = nullptr;
+    checkpointer *saving = nullptr;
+    /** Wall time limit, which also cuts short the polish of incumbents in the callback. */
+    utils::deadline stop;
+    /** Edges of each tour in the solution, read once after `solve` so no query goes back to the solver. */
+    utils::group<utils::edge_bits, M> chosen;
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline bool available(uint8_t i, unsigned u, unsigned v) const noexcept {
+        return utils::available(this->filter, i, u, v);
+    }
 
     [[gnu::cold]]
-    inline GRBVar add_edge(uint8_t i, const vertex& u, const vertex& v) {
+    inline GRBVar add_edge(uint8_t i, const vertex& u, const vertex& v, double objective, bool forced) {
         std::ostringstream name;
         name << 'x' << i << '_' << u.id() << '_' << v.id();
 
-        double objective = u[i].cost(v[i]);
-        return this->model.addVar(0., 1., objective, GRB_BINARY, name.str());
+        return this->model.addVar(forced ? 1. : 0., 1., objective, GRB_BINARY, name.str());
     }
 
     [[gnu::cold]]
     inline utils::matrix<GRBVar> add_vars(uint8_t i) {
         auto vars = utils::matrix<GRBVar>(this->order());
+        const auto& costs = this->data.costs(this->spaces[i]);
 
         for (unsigned u = 0; u < this->order(); u++) {
             for (unsigned v = u + 1; v < this->order(); v++) {
-                auto xi_uv = this->add_edge(i, this->vertices[u], this->vertices[v]);
+                if (!this->available(i, u, v)) [[unlikely]] {
+                    continue;
+                }
+                const bool forced = this->filter && this->filter->forced[i][u][v];
+                auto xi_uv = this->add_edge(i, this->vertices[u], this->vertices[v], costs[u][v], forced);
                 vars[u][v] = xi_uv;
                 vars[v][u] = xi_uv;
             }
@@ -80,12 +163,52 @@ private:
         return vars;
     }
 
+    /** Reads `X` of every variable of every tour with a single query into `chosen`. */
+    [[gnu::cold]]
+    void fetch() {
+        const size_t n = this->order();
+        auto all = std::vector<GRBVar>();
+        auto bits = std::vector<size_t>();
+        auto first = utils::group<size_t, M + 1>();
+        all.reserve(M * this->size());
+        bits.reserve(M * this->size());
+
+        for (uint8_t i = 0; i < M; i++) {
+            first[i] = all.size();
+            for (unsigned u = 0; u < n; u++) {
+                for (unsigned v = u + 1; v < n; v++) {
+                    if (this->available(i, u, v)) [[likely]] {
+                        all.push_back(this->vars[i][u][v]);
+                        bits.push_back(utils::edge_bits::index(n, u, v));
+                    }
+                }
+            }
+        }
+        first[M] = all.size();
+
+        const auto values = std::unique_ptr<double[]>(this->model.get(GRB_DoubleAttr_X, all.data(), int(all.size())));
+        for (uint8_t i = 0; i < M; i++) {
+            this->chosen[i] = utils::edge_bits(n);
+            for (size_t e = first[i]; e < first[i + 1]; e++) {
+                if (values[e] > 0.5) {
+                    this->chosen[i].insert(bits[e]);
+                }
+            }
+        }
+    }
+
+    template <size_t... I>
+    [[gnu::cold]]
+    inline utils::group<utils::matrix<GRBVar>, M> add_vars(std::index_sequence<I...>) {
+        return { this->add_vars(I)... };
+    }
+
     [[gnu::cold]]
     inline void add_constraint_deg_2(uint8_t i) {
         for (unsigned u = 0; u < this->order(); u++) {
             auto expr = GRBLinExpr();
             for (unsigned v = 0; v < this->order(); v++) {
-                if (u != v) [[likely]] {
+                if (u != v && this->available(i, u, v)) [[likely]] {
                     expr += this->vars[i][u][v];
                 }
             }
@@ -93,32 +216,103 @@ private:
         }
     }
 
+    /** Edges shared by tours `i` and `j`. */
     [[gnu::cold]]
-    inline void add_constraint_similarity(double k) {
+    inline void add_constraint_similarity(uint8_t i, uint8_t j, double k) {
         auto expr = GRBQuadExpr();
         for (unsigned u = 0; u < this->order(); u++) {
             for (unsigned v = u + 1; v < this->order(); v++) {
-                expr += this->vars[0][u][v] * this->vars[1][u][v];
+                if (this->available(i, u, v) && this->available(j, u, v)) [[likely]] {
+                    expr += this->vars[i][u][v] * this->vars[j][u][v];
+                }
             }
         }
         this->model.addQConstr(expr, GRB_GREATER_EQUAL, k);
     }
 
+    /** Edges in every tour, each bounded by its variable in all of them. */
+    [[gnu::cold]]
+    inline void add_constraint_common(double k) {
+        auto expr = GRBLinExpr();
+        for (unsigned u = 0; u < this->order(); u++) {
+            for (unsigned v = u + 1; v < this->order(); v++) {
+                bool everywhere = true;
+                for (uint8_t i = 0; i < M; i++) {
+                    everywhere = everywhere && this->available(i, u, v);
+                }
+                if (!everywhere) [[unlikely]] {
+                    continue;
+                }
+
+                const auto shared = this->model.addVar(0., 1., 0., GRB_CONTINUOUS);
+                for (uint8_t i = 0; i < M; i++) {
+                    this->model.addConstr(shared, GRB_LESS_EQUAL, this->vars[i][u][v]);
+                }
+                expr += shared;
+            }
+        }
+        this->model.addConstr(expr, GRB_GREATER_EQUAL, k);
+    }
+
+    [[gnu::cold]]
+    inline void add_constraint_similarity(double k) {
+        if (this->sharing == utils::sharing::common) [[unlikely]] {
+            return this->add_constraint_common(k);
+        }
+        for (uint8_t i = 0; i < M; i++) {
+            for (uint8_t j = i + 1; j < M; j++) {
+                this->add_constraint_similarity(i, j, k);
+            }
+        }
+    }
+
+    /** Tour `i` in space `vertex::space_of(i)`. */
+    [[gnu::const]] [[gnu::cold]] [[gnu::nothrow]]
+    static constexpr utils::group<uint8_t, M> spread() noexcept {
+        auto spaces = utils::group<uint8_t, M>();
+        for (uint8_t i = 0; i < M; i++) {
+            spaces[i] = vertex::space_of(i);
+        }
+        return spaces;
+    }
+
 public:
+    /** Full model over every edge, or a reduced one over the edges in `filter`. */
     [[gnu::cold]]
-    graph(std::span<const vertex> vertices, const GRBEnv& env, unsigned k = 0):
-        model(env), vertices(vertices), vars({ this->add_vars(0), this->add_vars(1) })
+    graph(
+        const instance& data,
+        const GRBEnv& env,
+        unsigned k = 0,
+        std::optional<utils::basic_edge_filter<M>> filter = std::nullopt,
+        utils::sharing sharing = utils::sharing::pairwise,
+        utils::group<uint8_t, M> spaces = spread()
+    ):
+        model(env), filter(std::move(filter)), data(data), vertices(data.vertices()), spaces(spaces),
+        vars(this->add_vars(std::make_index_sequence<M>())), k(k), sharing(sharing)
     {
-        this->add_constraint_deg_2(0);
-        this->add_constraint_deg_2(1);
+        for (uint8_t i = 0; i < M; i++) {
+            this->add_constraint_deg_2(i);
+        }
         if (k > 0) {
             this->add_constraint_similarity(k);
         }
         this->model.update();
     }
 
+    /** The instance modeled, whose cost tables are shared with every other model over it. */
+    const instance data;
     const std::span<const vertex> vertices;
-    const  utils::pair<utils::matrix<GRBVar>> vars;
+    /** Coordinate space of each tour. */
+    const utils::group<uint8_t, M> spaces;
+    const utils::group<utils::matrix<GRBVar>, M> vars;
+    /** Minimum number of shared edges between tours. */
+    const unsigned k;
+    const utils::sharing sharing;
+
+    /** Local search results over the incumbents found during `solve`. */
+    utils::polish_stats polishing;
+    /** Repair results over the integer solutions rejected during `solve`. */
+    utils::patch_stats patching;
 
     /** Number of vertices. */
     [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
@@ -143,22 +337,154 @@ public:
         return secs.count();
     }
 
+    /** Hash of the edges each tour is allowed, zero for a full model, so checkpoints only resume the same model. */
+    [[gnu::pure]] [[gnu::cold]]
+    uint64_t fingerprint() const {
+        if (!this->filter) [[likely]] {
+            return 0;
+        }
+        uint64_t seed = utils::fingerprint(std::span<const std::byte>());
+        for (uint8_t i = 0; i < M; i++) {
+            auto edges = utils::edge_bits(this->order());
+            for (unsigned u = 0; u < this->order(); u++) {
+                for (unsigned v = u + 1; v < this->order(); v++) {
+                    if (this->available(i, u, v)) [[likely]] {
+                        edges.insert(utils::edge_bits::index(this->order(), u, v));
+                    }
+                }
+            }
+            seed = utils::fingerprint(std::as_bytes(std::span(edges.data())), seed);
+        }
+        return seed;
+    }
+
+    /** Hands `tours`, complete tours as indices into `vertices`, to the solver as its MIP start. */
+    [[gnu::cold]]
+    void warm_start(const utils::group<::tour, M>& tours) {
+        for (uint8_t i = 0; i < M; i++) {
+            const auto edges = tours[i].edges(this->order());
+
+            for (unsigned u = 0; u < this->order(); u++) {
+                for (unsigned v = u + 1; v < this->order(); v++) {
+                    if (this->available(i, u, v)) [[likely]] {
+                        auto var = this->vars[i][u][v];
+                        var.set(GRB_DoubleAttr_Start, edges[u][v] ? 1.0 : 0.0);
+                    }
+                }
+            }
+        }
+    }
+
+    /** Stops `solve` after `secs` seconds, keeping the best solution found so far. */
+    [[gnu::cold]]
+    void time_limit(double secs) {
+        this->model.set(GRB_DoubleParam_TimeLimit, secs);
+        this->stop = utils::deadline::in(secs);
+    }
+
+    /** Writes the timeline of `solve` to `log`, which must outlive it. */
+    [[gnu::cold]]
+    void log_progress(progress_log& log) {
+        this->log = &log;
+    }
+
+    /** Saves the cuts and incumbents of `solve` through `saving`, which must outlive it. */
+    [[gnu::cold]]
+    void save_progress(checkpointer& saving) {
+        this->saving = &saving;
+    }
+
+    /** Adds the cuts of `saved` as constraints and its incumbent as the MIP start, which only pairs have. */
+    [[gnu::cold]]
+    void restore(const checkpoint& saved) {
+        for (const auto& [i, cycle] : saved.cuts) {
+            if (i >= M) [[unlikely]] {
+                continue;
+            }
+            auto expr = GRBLinExpr();
+            for (unsigned a = 0; a < cycle.size(); a++) {
+                for (unsigned b = a + 1; b < cycle.size(); b++) {
+                    if (this->available(i, cycle[a], cycle[b])) [[likely]] {
+                        expr += this->vars[i][cycle[a]][cycle[b]];
+                    }
+                }
+            }
+            this->model.addConstr(expr, GRB_LESS_EQUAL, cycle.size() - 1);
+        }
+        if constexpr (M == 2) {
+            if (saved.incumbent) [[likely]] {
+                this->warm_start(*saved.incumbent);
+            }
+        }
+        this->model.update();
+    }
+
+    /** Like `time_limit`, but in work units, about a second each, so runs repeat exactly. */
+    [[gnu::cold]]
+    void work_limit(double units) {
+        this->model.set(GRB_DoubleParam_WorkLimit, units);
+    }
+
     [[gnu::pure]] [[gnu::cold]]
     int64_t solution_count() const {
         return this->model.get(GRB_IntAttr_SolCount);
     }
 
+    /** If `solve` proved its solution optimal. */
+    [[gnu::pure]] [[gnu::cold]]
+    bool optimal() const {
+        return this->model.get(GRB_IntAttr_Status) == GRB_OPTIMAL;
+    }
+
+    /** Why `solve` stopped. */
+    [[gnu::pure]] [[gnu::cold]]
+    std::string_view status() const {
+        switch (this->model.get(GRB_IntAttr_Status)) {
+            case GRB_OPTIMAL:
+                return "optimal";
+            case GRB_TIME_LIMIT:
+                return "time limit";
+            case GRB_WORK_LIMIT:
+                return "work limit";
+            case GRB_INTERRUPTED:
+                return "interrupted";
+            case GRB_INFEASIBLE:
+            case GRB_INF_OR_UNBD:
+                return "infeasible";
+            default:
+                return "stopped";
+        }
+    }
+
     [[gnu::hot]]
     double solve() {
-        auto callback = subtour_elim(this->vertices, this->vars);
+        auto callback = subtour_elim<Metric, M>(this->vertices, this->spaces, this->vars, this->filter, this->k, this->log, this->saving, this->stop);
         this->model.setCallback(&callback);
 
         this->model.optimize();
         auto total_time = this->elapsed();
+        this->polishing = callback.polishing;
+        this->patching = callback.patching;
+
+        if (this->saving) [[unlikely]] {
+            this->saving->save();
+        }
+        if (this->log) [[unlikely]] {
+            const bool found = this->solution_count() > 0;
+            this->log->finish({
+                this->model.get(GRB_DoubleAttr_Runtime),
+                found ? this->solution_cost() : std::numeric_limits<double>::infinity(),
+                this->lower_bound(),
+                this->model.get(GRB_DoubleAttr_NodeCount),
+                callback.cuts,
+                callback.lazy,
+            });
+        }
 
         if (this->solution_count() <= 0) [[unlikely]] {
             throw utils::invalid_solution::zero_solutions(this->vertices);
         }
+        this->fetch();
         return total_time;
     }
 
@@ -167,6 +493,12 @@ public:
         return this->model.get(GRB_DoubleAttr_IterCount);
     }
 
+    /** Deterministic work spent by `solve`, independent of the load of the machine. */
+    [[gnu::pure]] [[gnu::cold]]
+    double work() const {
+        return this->model.get(GRB_DoubleAttr_Work);
+    }
+
     [[gnu::pure]] [[gnu::cold]]
     int64_t var_count() const {
         return this->model.get(GRB_IntAttr_NumVars);
@@ -192,13 +524,16 @@ public:
         return this->model.get(GRB_DoubleAttr_ObjVal);
     }
 
+    /** Best bound proven by the solver, equal to the cost when optimal. */
+    [[gnu::pure]] [[gnu::cold]]
+    double lower_bound() const {
+        return this->model.get(GRB_DoubleAttr_ObjBound);
+    }
+
+    /** If tour `i` of the solution uses `(u, v)`, only after `solve`. */
     [[gnu::pure]] [[gnu::hot]]
-    inline bool edge(uint8_t i, unsigned u, unsigned v) const {
-        if (u != v) [[likely]] {
-            return this->vars[i][u][v].get(GRB_DoubleAttr_X) > 0.5;
-        } else {
-            return false;
-        }
+    inline bool edge(uint8_t i, unsigned u, unsigned v) const noexcept {
+        return this->chosen[i].contains(u, v);
     }
 
     [[gnu::pure]] [[gnu::cold]]
@@ -220,18 +555,40 @@ public:
         return min;
     }
 
+    /** Every tour of the solution, as indices into `vertices`. */
+    [[gnu::pure]] [[gnu::cold]]
+    utils::group<::tour, M> tours() const {
+        auto tours = utils::group<::tour, M>();
+        for (uint8_t i = 0; i < M; i++) {
+            tours[i] = this->tour(i);
+        }
+        return tours;
+    }
+
+    /** Edges shared by tours `i` and `j`. */
+    [[gnu::pure]] [[gnu::cold]]
+    unsigned similarity(uint8_t i, uint8_t j) const {
+        return this->chosen[i].shared(this->chosen[j]);
+    }
+
+    /** The count bounded by `k`: the fewest edges shared by two tours, or the edges in all of them. */
     [[gnu::pure]] [[gnu::cold]]
     unsigned similarity() const {
-        unsigned total = 0;
-        for (unsigned u = 0; u < this->order(); u++) {
-            for (unsigned v = u + 1; v < this->order(); v++) {
+        if (this->sharing == utils::sharing::common) [[unlikely]] {
+            auto everywhere = this->chosen[0];
+            for (uint8_t i = 1; i < M; i++) {
+                everywhere &= this->chosen[i];
+            }
+            return everywhere.count();
+        }
 
-                if (this->edge(0, u, v) && this->edge(1, u, v)) [[unlikely]] {
-                    total += 1;
-                }
+        auto fewest = std::numeric_limits<unsigned>::max();
+        for (uint8_t i = 0; i < M; i++) {
+            for (uint8_t j = i + 1; j < M; j++) {
+                fewest = std::min(fewest, this->similarity(i, j));
             }
         }
-        return total;
+        return fewest;
     }
 
     [[gnu::pure]] [[gnu::cold]]
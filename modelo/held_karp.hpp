@@ -0,0 +1,328 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "vertex.hpp"
+#include "tour.hpp"
+#include "local_search.hpp"
+
+
+namespace utils {
+    /** How the local search candidate lists are chosen. */
+    enum class candidate_set : uint8_t {
+        /** Closest vertices in the space. */
+        nearest,
+        /** Smallest increase of the best 1-tree when the edge is forced into it. */
+        alpha,
+    };
+}
+
+
+/**
+ * Held-Karp lower bound for the tour in one space: the cheapest 1-tree, a spanning tree over
+ * every vertex but the first plus its two cheapest edges, under vertex penalties `pi` that
+ * subgradient optimization moves towards making every degree two. Each 1-tree comes from
+ * Prim's algorithm over the dense cost table, in O(n^2).
+ */
+template <typename Metric>
+struct held_karp final {
+private:
+    utils::matrix<double> costs;
+    std::vector<double> pi;
+    std::vector<double> best_pi;
+
+    /** Parent of each vertex in the spanning tree over all but vertex 0, rooted at vertex 1. */
+    std::vector<unsigned> parent;
+    /** Vertices in the order they joined the spanning tree, so parents come first. */
+    std::vector<unsigned> sequence;
+    /** The two edges of vertex 0, cheapest first, and their costs. */
+    utils::pair<unsigned> special;
+    utils::pair<double> special_cost;
+    std::vector<int> degree;
+
+    double best = -std::numeric_limits<double>::infinity();
+    unsigned iter = 0;
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline size_t count() const noexcept {
+        return this->costs.size();
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline double penalized(unsigned u, unsigned v) const noexcept {
+        return this->costs[u][v] + this->pi[u] + this->pi[v];
+    }
+
+    /** Builds the cheapest 1-tree under the current penalties, returning its bound. */
+    [[gnu::hot]]
+    double one_tree() {
+        const size_t n = this->count();
+        auto key = std::vector<double>(n, std::numeric_limits<double>::infinity());
+        auto done = std::vector<char>(n, false);
+        std::fill(this->degree.begin(), this->degree.end(), 0);
+
+        double total = 0.0;
+        key[1] = 0.0;
+        this->parent[1] = 1;
+        for (unsigned step = 1; step < n; step++) {
+            unsigned u = 0;
+            double min = std::numeric_limits<double>::infinity();
+            for (unsigned v = 1; v < n; v++) {
+                if (!done[v] && key[v] < min) {
+                    min = key[v];
+                    u = v;
+                }
+            }
+
+            done[u] = true;
+            total += min;
+            this->sequence[step - 1] = u;
+            if (this->parent[u] != u) [[likely]] {
+                this->degree[u] += 1;
+                this->degree[this->parent[u]] += 1;
+            }
+            for (unsigned v = 1; v < n; v++) {
+                const double cost = this->penalized(u, v);
+                if (!done[v] && cost < key[v]) {
+                    key[v] = cost;
+                    this->parent[v] = u;
+                }
+            }
+        }
+
+        auto& [first, second] = this->special;
+        double c1 = std::numeric_limits<double>::infinity(), c2 = c1;
+        for (unsigned v = 1; v < n; v++) {
+            const double cost = this->penalized(0, v);
+            if (cost < c1) {
+                second = std::exchange(first, v);
+                c2 = std::exchange(c1, cost);
+            } else if (cost < c2) {
+                second = v;
+                c2 = cost;
+            }
+        }
+        this->special_cost = { c1, c2 };
+        this->degree[0] = 2;
+        this->degree[first] += 1;
+        this->degree[second] += 1;
+        total += c1 + c2;
+
+        double penalties = 0.0;
+        for (const double p : this->pi) {
+            penalties += p;
+        }
+        return total - 2.0 * penalties;
+    }
+
+    /**
+     * Alpha value of every edge `(u, v)` in the current 1-tree: its penalized cost minus the
+     * most expensive edge it would replace, the one on the tree path from `u` to `v`, or
+     * the second edge of vertex 0. The path maxima come from walking up from `u` and then
+     * down the tree in insertion order, in O(n) per row.
+     */
+    [[gnu::hot]]
+    void alpha_row(unsigned u, std::vector<double>& row, std::vector<double>& beta, std::vector<unsigned>& mark) const {
+        const size_t n = this->count();
+        const auto [first, second] = this->special;
+        const auto is_special = [first, second](unsigned v) {
+            return v == first || v == second;
+        };
+
+        if (u == 0) [[unlikely]] {
+            for (unsigned v = 1; v < n; v++) {
+                row[v] = is_special(v) ? 0.0 : this->penalized(0, v) - this->special_cost[1];
+            }
+            return;
+        }
+        row[0] = is_special(u) ? 0.0 : this->penalized(0, u) - this->special_cost[1];
+
+        beta[u] = -std::numeric_limits<double>::infinity();
+        mark[u] = u;
+        for (unsigned v = u; this->parent[v] != v; v = this->parent[v]) {
+            const unsigned up = this->parent[v];
+            beta[up] = std::max(beta[v], this->penalized(v, up));
+            mark[up] = u;
+        }
+
+        for (const unsigned v : this->sequence) {
+            if (mark[v] != u) {
+                const unsigned up = this->parent[v];
+                beta[v] = std::max(beta[up], this->penalized(v, up));
+            }
+            row[v] = v == u ? 0.0 : this->penalized(u, v) - beta[v];
+        }
+    }
+
+    /** Cost of the nearest neighbor tour, an upper bound for the step size. */
+    [[gnu::pure]] [[gnu::cold]]
+    double nearest_neighbor() const {
+        const size_t n = this->count();
+        auto seen = std::vector<bool>(n, false);
+        double total = 0.0;
+        unsigned u = 0;
+
+        seen[0] = true;
+        for (unsigned step = 1; step < n; step++) {
+            unsigned next = 0;
+            double min = std::numeric_limits<double>::infinity();
+            for (unsigned v = 0; v < n; v++) {
+                if (!seen[v] && this->costs[u][v] < min) {
+                    min = this->costs[u][v];
+                    next = v;
+                }
+            }
+            seen[next] = true;
+            total += min;
+            u = next;
+        }
+        return total + this->costs[u][0];
+    }
+
+public:
+    [[gnu::cold]]
+    held_karp(std::span<const vertex> vertices, uint8_t i):
+        held_karp(utils::columns(vertices)[i])
+    { }
+
+    [[gnu::cold]]
+    explicit held_karp(const utils::plane& space):
+        costs(utils::tabulate<Metric>(space)), pi(space.size(), 0.0), best_pi(space.size(), 0.0),
+        parent(space.size(), 0), sequence(space.size() > 0 ? space.size() - 1 : 0, 0),
+        special({ 0, 0 }), special_cost({ 0.0, 0.0 }), degree(space.size(), 0)
+    { }
+
+    /**
+     * Subgradient optimization with Polyak steps towards `upper`, the cost of any tour, or
+     * of the nearest neighbor tour if not given. The step factor halves after 10 rounds
+     * without improvement, until it is too small, a 1-tree is a tour, or `max_iterations`.
+     */
+    [[gnu::hot]]
+    double optimize(std::optional<double> upper = std::nullopt, unsigned max_iterations = 1000) {
+        const size_t n = this->count();
+        if (n < 3) [[unlikely]] {
+            this->best = n == 2 ? 2.0 * this->costs[0][1] : 0.0;
+            return this->best;
+        }
+        const double target = upper ? *upper : this->nearest_neighbor();
+
+        double lambda = 2.0;
+        unsigned stale = 0;
+        for (this->iter = 0; this->iter < max_iterations && lambda > 1e-3; this->iter++) {
+            const double bound = this->one_tree();
+            if (bound > this->best + 1e-9) {
+                this->best = bound;
+                this->best_pi = this->pi;
+                stale = 0;
+            } else if (++stale >= 10) {
+                lambda /= 2.0;
+                stale = 0;
+            }
+
+            double norm = 0.0;
+            for (unsigned v = 0; v < n; v++) {
+                const int d = this->degree[v] - 2;
+                norm += d * d;
+            }
+            const double step = lambda * (target - bound) / std::max(norm, 1.0);
+            if (norm == 0.0 || step <= 0.0) [[unlikely]] {
+                break;
+            }
+            for (unsigned v = 0; v < n; v++) {
+                this->pi[v] += step * (this->degree[v] - 2);
+            }
+        }
+
+        this->pi = this->best_pi;
+        this->one_tree();
+        return this->best;
+    }
+
+    /** Best bound found, rounded up since every edge cost is integral. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline double lower_bound() const noexcept {
+        return std::ceil(this->best - 1e-6);
+    }
+
+    /** Penalties of the best bound. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline std::span<const double> penalties() const noexcept {
+        return this->pi;
+    }
+
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline unsigned iterations() const noexcept {
+        return this->iter;
+    }
+
+    /**
+     * Edges that some tour costing at most `limit` may use. Any tour through `(u, v)` costs
+     * at least the 1-tree bound with the edge forced, the best bound plus its alpha value.
+     */
+    [[gnu::hot]]
+    utils::matrix<bool> viable(double limit) const {
+        const size_t n = this->count();
+        auto result = utils::matrix<bool>(n);
+        auto row = std::vector<double>(n), beta = std::vector<double>(n);
+        auto mark = std::vector<unsigned>(n, n);
+
+        for (unsigned u = 0; u < n; u++) {
+            result[u][u] = false;
+            if (n < 3) [[unlikely]] {
+                for (unsigned v = u + 1; v < n; v++) {
+                    result[u][v] = result[v][u] = true;
+                }
+                continue;
+            }
+
+            this->alpha_row(u, row, beta, mark);
+            for (unsigned v = u + 1; v < n; v++) {
+                const bool keep = std::ceil(this->best + row[v] - 1e-6) <= limit + 1e-6;
+                result[u][v] = result[v][u] = keep;
+            }
+        }
+        return result;
+    }
+
+    /** The `width` edges of each vertex with the smallest alpha value, ties broken by cost. */
+    [[gnu::hot]]
+    neighbors alpha_nearest(unsigned width = 10) const {
+        const size_t n = this->count();
+        auto row = std::vector<double>(n), beta = std::vector<double>(n);
+        auto mark = std::vector<unsigned>(n, n);
+        auto current = n;
+
+        return neighbors::smallest(n, width, [&](unsigned u, unsigned v) {
+            if (u != current) [[unlikely]] {
+                this->alpha_row(u, row, beta, mark);
+                current = u;
+            }
+            return row[v] + 1e-6 * this->costs[u][v];
+        });
+    }
+
+    /** Candidate lists over `space`, computing the Held-Karp bound if needed. */
+    [[gnu::cold]]
+    static neighbors candidates(const utils::plane& space, utils::candidate_set set, unsigned width = 10) {
+        if (set == utils::candidate_set::nearest || space.size() < 3) [[likely]] {
+            return neighbors::nearest<Metric>(space, width);
+        }
+
+        auto hk = held_karp(space);
+        hk.optimize();
+        return hk.alpha_nearest(width);
+    }
+
+    /** Candidate lists for space `i` of `vertices`. */
+    [[gnu::cold]]
+    static neighbors candidates(std::span<const vertex> vertices, uint8_t i, utils::candidate_set set, unsigned width = 10) {
+        return candidates(utils::columns(vertices)[i], set, width);
+    }
+};
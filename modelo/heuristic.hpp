@@ -0,0 +1,392 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "vertex.hpp"
+#include "tour.hpp"
+#include "instance.hpp"
+#include "polish.hpp"
+#include "patch.hpp"
+#include "local_search.hpp"
+#include "paired.hpp"
+#include "held_karp.hpp"
+
+
+/**
+ * Iterated local search over k-similar tour pairs, without any solver behind it. Each
+ * iteration kicks one of the tours with a double bridge, improves the pair again and keeps
+ * it if it is not worse than the current one. Each tour is improved by the candidate list
+ * descent, with Lin-Kernighan chains of up to `depth` steps, starting only from the vertices
+ * around the kick, and skipping moves that would leave the pair with less than `k` shared edges.
+ */
+template <typename Metric>
+struct heuristic final {
+private:
+    std::mt19937_64 rng;
+    /** Coordinates of both spaces as contiguous arrays, for every cost the search computes. */
+    const utils::columns coords;
+    const utils::pair<neighbors> near;
+    utils::pair<tour> best;
+    double best_cost;
+
+    unsigned kicked = 0;
+    unsigned accepted = 0;
+    unsigned improvements = 0;
+    uint64_t evaluated = 0;
+
+    /** When `solve` stops, checked between kicks and inside every descent. */
+    utils::deadline stop;
+    bool timed_out = false;
+
+    /** A kicked pair, with the vertices whose edges changed. */
+    struct kick_result final {
+        utils::pair<tour> tours;
+        uint8_t i;
+        bool mirrored;
+        std::array<unsigned, 6> dirty;
+    };
+
+    [[gnu::pure]] [[gnu::hot]]
+    inline double cost(const utils::pair<tour>& tours) const noexcept {
+        return tours[0].cost<Metric>(this->coords[0]) + tours[1].cost<Metric>(this->coords[1]);
+    }
+
+    [[gnu::pure]] [[gnu::hot]]
+    inline double cost(uint8_t i, unsigned u, unsigned v) const noexcept {
+        return this->coords[i].cost<Metric>(u, v);
+    }
+
+    [[gnu::cold]]
+    tour nearest_neighbor(uint8_t i) const {
+        const size_t n = this->order();
+        auto seen = std::vector<bool>(n, false);
+
+        auto path = tour();
+        path.reserve(n);
+        unsigned u = 0;
+
+        for (unsigned len = 0; len < n; len++) {
+            seen[u] = true;
+            path.push_back(u);
+
+            // each step scans every vertex, so past the deadline the rest go in index order
+            if (len % 64 == 0 && this->stop.passed()) [[unlikely]] {
+                for (unsigned v = 0; v < n; v++) {
+                    if (!seen[v]) {
+                        path.push_back(v);
+                    }
+                }
+                break;
+            }
+
+            std::optional<unsigned> next = std::nullopt;
+            for (unsigned v = 0; v < n; v++) {
+                if (!seen[v] && (!next || this->cost(i, u, v) < this->cost(i, u, *next))) {
+                    next = v;
+                }
+            }
+            if (next) [[likely]] {
+                u = *next;
+            }
+        }
+        return path;
+    }
+
+    /** Swaps the blocks of `len1` and `len2` vertices starting at position `start`. */
+    [[gnu::hot]]
+    static void swap_blocks(tour& t, unsigned start, unsigned len1, unsigned len2) {
+        const size_t n = t.size();
+        auto window = std::vector<unsigned>();
+        window.reserve(len1 + len2);
+
+        for (unsigned off = 0; off < len1 + len2; off++) {
+            window.push_back(t[(start + off) % n]);
+        }
+        std::rotate(window.begin(), window.begin() + len1, window.end());
+        for (unsigned off = 0; off < len1 + len2; off++) {
+            t[(start + off) % n] = window[off];
+        }
+    }
+
+    /**
+     * Applies to `other` the double bridge done in a window of `t` starting at `start`, if
+     * `other` visits that window in the same order, forwards or backwards.
+     */
+    [[gnu::hot]]
+    static bool mirror(const tour& t, tour& other, unsigned start, unsigned len1, unsigned len2) {
+        const size_t n = t.size();
+        const unsigned span = len1 + len2 + 2;
+        const unsigned first = t[(start + n - 1) % n];
+        const unsigned at = std::find(other.begin(), other.end(), first) - other.begin();
+
+        bool forward = true, backward = true;
+        for (unsigned off = 0; off < span; off++) {
+            const unsigned v = t[(start + n - 1 + off) % n];
+            forward &= other[(at + off) % n] == v;
+            backward &= other[(at + n - off) % n] == v;
+        }
+
+        if (forward) {
+            swap_blocks(other, (at + 1) % n, len1, len2);
+        } else if (backward) {
+            swap_blocks(other, (at + n - span + 2) % n, len2, len1);
+        }
+        return forward || backward;
+    }
+
+    /** Double bridge on a window of one of the tours, mirrored on the other to keep them k-similar. */
+    [[gnu::hot]]
+    std::optional<kick_result> kick(const utils::pair<tour>& current) {
+        const size_t n = this->order();
+        if (n < 8) [[unlikely]] {
+            return std::nullopt;
+        }
+        const unsigned max_len = std::min<unsigned>(50, (n - 2) / 2);
+        auto len = std::uniform_int_distribution<unsigned>(1, max_len);
+        auto pos = std::uniform_int_distribution<unsigned>(0, n - 1);
+
+        for (unsigned attempt = 0; attempt < 8; attempt++) {
+            auto kicked = current;
+            const uint8_t i = this->rng() & 1;
+            const unsigned start = pos(this->rng), len1 = len(this->rng), len2 = len(this->rng);
+
+            const auto& t = current[i];
+            const auto dirty = std::array<unsigned, 6> {
+                t[(start + n - 1) % n], t[start % n],
+                t[(start + len1 - 1) % n], t[(start + len1) % n],
+                t[(start + len1 + len2 - 1) % n], t[(start + len1 + len2) % n],
+            };
+
+            swap_blocks(kicked[i], start, len1, len2);
+            if (patch<Metric>::shared(kicked[0], kicked[1]) >= this->k) [[likely]] {
+                return kick_result { std::move(kicked), i, false, dirty };
+            }
+            if (mirror(current[i], kicked[1 - i], start, len1, len2)) {
+                return kick_result { std::move(kicked), i, true, dirty };
+            }
+        }
+        return std::nullopt;
+    }
+
+    /** Candidate list descent on tour `i`, starting from `dirty`, or from every vertex if empty. */
+    [[gnu::hot]]
+    tour descend(uint8_t i, const tour& t, std::span<const unsigned> dirty) {
+        auto search = local_search(utils::space_cost<Metric> { this->coords[i] }, this->near[i], t, this->depth, utils::unconstrained(), this->stop);
+        if (dirty.empty()) {
+            search.activate_all();
+        }
+        for (const unsigned v : dirty) {
+            search.activate(v);
+        }
+
+        search.optimize();
+        this->evaluated += search.evaluations();
+        return search.result();
+    }
+
+    /** Paired descent on both tours, keeping them `k`-similar, starting from `dirty` or every vertex if empty. */
+    [[gnu::hot]]
+    utils::pair<tour> descend(const utils::pair<tour>& tours, std::span<const unsigned> dirty) {
+        auto search = paired_search<Metric>(this->coords, this->near, this->k, tours, this->depth, this->stop);
+        search.optimize(dirty);
+        this->evaluated += search.evaluations();
+        return search.result();
+    }
+
+    [[gnu::cold]]
+    utils::pair<tour> initial() {
+        auto tours = utils::pair<tour> {
+            this->descend(0, this->nearest_neighbor(0), {}),
+            this->descend(1, this->nearest_neighbor(1), {}),
+        };
+        if (this->k == 0) [[likely]] {
+            return tours;
+        }
+
+        // the polish finishes with moves applied to both tours at once, which the paired
+        // descent lacks and which matter most when the tours are forced alike
+        patch<Metric>::make_similar(this->coords, this->k, tours);
+        if (auto polished = polish<Metric>::improve(this->coords, this->near, this->k, tours, this->stop)) [[likely]] {
+            tours = std::move(*polished);
+        }
+        return tours;
+    }
+
+    /** Improves a kicked pair around the kick, only touching the kicked tour when there is no similarity to keep. */
+    [[gnu::hot]]
+    utils::pair<tour> improve(kick_result& kicked) {
+        if (this->k == 0) [[likely]] {
+            kicked.tours[kicked.i] = this->descend(kicked.i, kicked.tours[kicked.i], kicked.dirty);
+            return std::move(kicked.tours);
+        }
+        return this->descend(kicked.tours, kicked.dirty);
+    }
+
+public:
+    /** Searches over the coordinate columns of `data`, so a mapped instance never builds its vertices. */
+    [[gnu::cold]]
+    heuristic(
+        const instance& data,
+        unsigned k = 0,
+        unsigned kicks = 1000,
+        unsigned depth = utils::lk_depth,
+        utils::candidate_set candidates = utils::candidate_set::nearest,
+        unsigned width = 10,
+        uint64_t seed = 0
+    ):
+        heuristic(data, { held_karp<Metric>::candidates(data.space(0), candidates, width), held_karp<Metric>::candidates(data.space(1), candidates, width) },
+            k, kicks, depth, seed)
+    { }
+
+    /** Searches with candidate lists computed beforehand, such as the ones stored in a binary instance. */
+    [[gnu::cold]]
+    heuristic(
+        const instance& data,
+        utils::pair<neighbors> near,
+        unsigned k = 0,
+        unsigned kicks = 1000,
+        unsigned depth = utils::lk_depth,
+        uint64_t seed = 0
+    ):
+        rng(seed), coords(data.columns()), near(std::move(near)), best_cost(0.0), data(data), k(k), kicks(kicks), depth(depth)
+    { }
+
+    /** The vertices searched, only read for the final tours. */
+    const instance data;
+    /** Minimum number of shared edges between tours. */
+    const unsigned k;
+    /** Number of double bridge kicks to try. */
+    const unsigned kicks;
+    /** Maximum steps in a Lin-Kernighan chain, disabled below two. */
+    const unsigned depth;
+
+    /** Number of vertices. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline size_t order() const noexcept {
+        return this->data.size();
+    }
+
+    /** Number of edges. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline size_t size() const noexcept {
+        const size_t order = this->order();
+        return (order * (order - 1)) / 2;
+    }
+
+    using clock = std::chrono::high_resolution_clock;
+    const clock::time_point start = clock::now();
+
+    [[gnu::cold]] [[gnu::nothrow]]
+    inline double elapsed() const noexcept {
+        auto end = clock::now();
+        std::chrono::duration<double> secs = end - this->start;
+        return secs.count();
+    }
+
+    /**
+     * Stops `solve` after `secs` seconds, keeping the best pair found so far. The initial
+     * pair stops improving too, so it may come out of a partial descent.
+     */
+    [[gnu::cold]]
+    void time_limit(double secs) {
+        this->stop = utils::deadline::in(secs - this->elapsed());
+    }
+
+    [[gnu::hot]]
+    double solve() {
+        this->best = this->initial();
+        this->best_cost = this->cost(this->best);
+        this->improvements = 1;
+        this->timed_out = this->stop.passed();
+
+        for (unsigned iter = 0; iter < this->kicks && !this->timed_out; iter++) {
+            if (this->stop.passed()) [[unlikely]] {
+                this->timed_out = true;
+                break;
+            }
+            auto kicked = this->kick(this->best);
+            if (!kicked) [[unlikely]] {
+                continue;
+            }
+            this->kicked += 1;
+
+            auto candidate = this->improve(*kicked);
+            const double cost = this->cost(candidate);
+            if (cost <= this->best_cost) [[unlikely]] {
+                this->accepted += 1;
+                if (cost < this->best_cost - 0.5) {
+                    this->improvements += 1;
+                }
+                this->best = std::move(candidate);
+                this->best_cost = cost;
+            }
+        }
+        return this->elapsed();
+    }
+
+    /** Number of times the best pair improved, counting the initial one. */
+    [[gnu::pure]] [[gnu::cold]]
+    int64_t solution_count() const {
+        return this->improvements;
+    }
+
+    /** Why `solve` stopped. */
+    [[gnu::pure]] [[gnu::cold]]
+    std::string_view status() const {
+        return this->timed_out ? "time limit" : "kick limit";
+    }
+
+    /** Kicks actually applied. */
+    [[gnu::pure]] [[gnu::cold]]
+    int64_t iterations() const {
+        return this->kicked;
+    }
+
+    /** Moves evaluated by the candidate list descent. */
+    [[gnu::pure]] [[gnu::cold]]
+    uint64_t evaluation_count() const {
+        return this->evaluated;
+    }
+
+    /** Kicked pairs kept as the current one. */
+    [[gnu::pure]] [[gnu::cold]]
+    int64_t accepted_count() const {
+        return this->accepted;
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    double solution_cost() const {
+        return this->best_cost;
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    unsigned similarity() const {
+        return patch<Metric>::shared(this->best[0], this->best[1]);
+    }
+
+    /** Best pair found, as indices into the vertices. */
+    [[gnu::pure]] [[gnu::cold]]
+    const utils::pair<tour>& tours() const {
+        return this->best;
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    auto solution(uint8_t i) const {
+        const auto all = this->data.vertices();
+        auto vertices = std::vector<vertex>();
+        vertices.reserve(this->order());
+
+        for (unsigned v : this->best[i]) {
+            vertices.push_back(all[v]);
+        }
+        return vertices;
+    }
+};
@@ -0,0 +1,358 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "vertex.hpp"
+#include "tour.hpp"
+#include "coordinates.hpp"
+
+
+/** Read-only memory map of a whole file, released on destruction. */
+struct mapped_file final {
+private:
+    const char *data = nullptr;
+    size_t len = 0;
+
+public:
+    [[gnu::cold]]
+    explicit mapped_file(const std::string& path) {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) [[unlikely]] {
+            throw utils::invalid_file::is_empty_or_missing(path);
+        }
+
+        struct stat info;
+        if (::fstat(fd, &info) != 0) [[unlikely]] {
+            ::close(fd);
+            throw utils::invalid_file::is_empty_or_missing(path);
+        }
+
+        this->len = size_t(info.st_size);
+        if (this->len > 0) [[likely]] {
+            void *addr = ::mmap(nullptr, this->len, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED) [[unlikely]] {
+                ::close(fd);
+                throw utils::invalid_file::is_empty_or_missing(path);
+            }
+            ::madvise(addr, this->len, MADV_SEQUENTIAL);
+            this->data = static_cast<const char *>(addr);
+        }
+        ::close(fd);
+    }
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    inline ~mapped_file() {
+        if (this->data) [[likely]] {
+            ::munmap(const_cast<char *>(this->data), this->len);
+        }
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline std::string_view contents() const noexcept {
+        return std::string_view(this->data, this->len);
+    }
+};
+
+
+/**
+ * The vertices of one problem. Copies and prefixes share the storage, which the instance owns
+ * or keeps alive, so several instances or several sizes of one can be held at once. They also
+ * share a structure of arrays view of the coordinates, for the loops over many vertices, and
+ * each copy shares the cost table of each space, built once when a model first asks for it.
+ * A mapped instance starts from ids and columns alone, and only builds its `vertex` records
+ * if something asks for them, since the searches run over the columns.
+ * Costs are in the metric of the instance, `CEIL_2D` unless its file says otherwise.
+ *
+ * Text instances are in the `coordenadas.txt` format: one vertex per line, with the coordinates
+ * of both spaces as `x1 y1 x2 y2`, and ids from one in file order. Blank lines are skipped.
+ */
+struct instance final {
+private:
+    struct tables final {
+    public:
+        std::array<std::once_flag, 2> built;
+        std::array<std::optional<utils::matrix<double>>, 2> costs;
+    };
+
+    /** Vertices of a mapped instance, shared by its copies and prefixes. */
+    struct records final {
+    public:
+        std::span<const int32_t> ids;
+        std::once_flag built;
+        std::vector<vertex> vertices;
+    };
+
+    std::shared_ptr<const void> owner;
+    std::span<const vertex> points;
+    std::shared_ptr<records> mapped;
+    size_t count = 0;
+    std::shared_ptr<const utils::columns> coords;
+    std::shared_ptr<tables> cache;
+    metric::kind measure = metric::kind::ceil_2d;
+
+    [[gnu::cold]]
+    instance(
+        std::shared_ptr<const void> owner,
+        std::span<const vertex> vertices,
+        std::shared_ptr<records> mapped,
+        size_t count,
+        std::shared_ptr<const utils::columns> coords,
+        metric::kind measure
+    ):
+        owner(std::move(owner)), points(vertices), mapped(std::move(mapped)), count(count), coords(std::move(coords)),
+        cache(std::make_shared<tables>()), measure(measure)
+    { }
+
+public:
+    /** Vertices owned by `owner`, or with static storage if it is null. */
+    [[gnu::cold]]
+    instance(std::shared_ptr<const void> owner, std::span<const vertex> vertices):
+        instance(std::move(owner), vertices, nullptr, vertices.size(), std::make_shared<const utils::columns>(vertices), metric::kind::ceil_2d)
+    { }
+
+    [[gnu::cold]]
+    explicit instance(std::vector<vertex> vertices): instance(nullptr, {}) {
+        const auto owned = std::make_shared<const std::vector<vertex>>(std::move(vertices));
+        this->points = *owned;
+        this->count = this->points.size();
+        this->coords = std::make_shared<const utils::columns>(this->points);
+        this->owner = owned;
+    }
+
+    /** The vertices `ids` with the coordinates `coords`, both owned by `owner` and used in place. */
+    [[gnu::cold]]
+    instance(std::shared_ptr<const void> owner, std::span<const int32_t> ids, const utils::columns& coords, metric::kind measure):
+        instance(std::move(owner), {}, std::make_shared<records>(), ids.size(), std::make_shared<const utils::columns>(coords), measure)
+    {
+        this->mapped->ids = ids;
+    }
+
+    /** The vertices embedded in the program, from `coordenadas.txt`. */
+    [[gnu::cold]]
+    static instance embedded() {
+        return instance(nullptr, DEFAULT_VERTICES);
+    }
+
+    /** The vertices, which a mapped instance builds from its ids and columns on the first call. */
+    [[gnu::hot]]
+    std::span<const vertex> vertices() const {
+        if (this->mapped) [[unlikely]] {
+            std::call_once(this->mapped->built, [this] {
+                const auto ids = this->mapped->ids;
+                const auto first = (*this->coords)[0], second = (*this->coords)[1];
+                this->mapped->vertices.reserve(ids.size());
+                for (size_t v = 0; v < ids.size(); v++) {
+                    this->mapped->vertices.push_back(vertex::with_id(unsigned(ids[v]), first.x[v], first.y[v], second.x[v], second.y[v]));
+                }
+            });
+            return std::span<const vertex>(this->mapped->vertices).first(this->count);
+        }
+        return this->points;
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline size_t size() const noexcept {
+        return this->count;
+    }
+
+    [[gnu::hot]]
+    inline const vertex& operator[](unsigned v) const {
+        return this->vertices()[v];
+    }
+
+    /** Id of vertex `v`, without building the vertices of a mapped instance. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline unsigned id(unsigned v) const noexcept {
+        return this->mapped ? unsigned(this->mapped->ids[v]) : this->points[v].id();
+    }
+
+    /** The first `n` vertices, sharing the storage but with cost tables of their own. */
+    [[gnu::cold]]
+    instance first(size_t n) const {
+        if (n > this->size()) [[unlikely]] {
+            throw this->mapped ? utils::not_enough_items::in(this->mapped->ids.first(this->count), n) : utils::not_enough_items::in(this->points, n);
+        }
+        const auto prefix = this->mapped ? std::span<const vertex>() : this->points.first(n);
+        return n == this->size() ? *this : instance(this->owner, prefix, this->mapped, n, this->coords, this->measure);
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline metric::kind metric() const noexcept {
+        return this->measure;
+    }
+
+    /** The same vertices measured by `measure`, with cost tables of their own if it differs. */
+    [[gnu::cold]]
+    instance with_metric(metric::kind measure) const {
+        return measure == this->measure ? *this : instance(this->owner, this->points, this->mapped, this->count, this->coords, measure);
+    }
+
+    /** Coordinates of both spaces, as contiguous arrays. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline utils::columns columns() const noexcept {
+        return this->coords->first(this->size());
+    }
+
+    /** Coordinates of space `i`, as contiguous arrays. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline utils::plane space(uint8_t i) const noexcept {
+        return (*this->coords)[i].first(this->size());
+    }
+
+    /**
+     * Costs between every pair of vertices in space `i`, on the first call. The embedded
+     * vertices, or a prefix of them, copy the tables the compiler already computed.
+     */
+    [[gnu::hot]]
+    const utils::matrix<double>& costs(uint8_t i) const {
+        std::call_once(this->cache->built[i], [this, i] {
+            if (this->points.data() != DEFAULT_VERTICES.data() || this->measure != metric::kind::ceil_2d) [[unlikely]] {
+                this->cache->costs[i].emplace(metric::dispatch(this->measure, [this, i](auto policy) {
+                    return utils::tabulate<decltype(policy)>(this->space(i));
+                }));
+                return;
+            }
+
+            const size_t n = this->size(), stride = DEFAULT_VERTICES.size();
+            auto table = utils::matrix<double>(n);
+            for (size_t u = 0; u < n; u++) {
+                std::copy_n(DEFAULT_COSTS[i].begin() + u * stride, n, table[u].begin());
+            }
+            this->cache->costs[i].emplace(std::move(table));
+        });
+        return *this->cache->costs[i];
+    }
+
+    /** First character at or after `it` that is not a space, tab or carriage return. */
+    [[gnu::hot]] [[gnu::nothrow]]
+    static inline const char *skip_blank(const char *it, const char *end) noexcept {
+        while (it < end && (*it == ' ' || *it == '\t' || *it == '\r')) {
+            it++;
+        }
+        return it;
+    }
+
+    /**
+     * Leading digits of the eight bytes at `p` and their value, from a single load. Bytes
+     * after the first non-digit may be clobbered by carries, but they are never looked at.
+     */
+    [[gnu::hot]] [[gnu::nothrow]]
+    static inline std::pair<unsigned, uint64_t> eight_digits(const char *p) noexcept {
+        uint64_t chunk;
+        std::memcpy(&chunk, p, sizeof(chunk));
+
+        // a byte is zero here only if its high nibble is 3 both as is and plus 6, i.e. '0' to '9'
+        const uint64_t high = 0xf0f0f0f0f0f0f0f0U;
+        const uint64_t other = ((chunk & high) ^ 0x3030303030303030U) | (((chunk + 0x0606060606060606U) & high) ^ 0x3030303030303030U);
+        const uint64_t marks = ((other + 0x7f7f7f7f7f7f7f7fU) | other) & 0x8080808080808080U;
+        const unsigned len = marks == 0 ? 8 : unsigned(std::countr_zero(marks)) / 8;
+        if (len == 0) [[unlikely]] {
+            return { 0, 0 };
+        }
+
+        // digits to the top bytes, so the ones shifted in act as leading zeros
+        uint64_t value = (chunk - 0x3030303030303030U) << (8 * (8 - len));
+        value = ((value & 0x0f0f0f0f0f0f0f0fU) * 2561) >> 8;
+        value = ((value & 0x00ff00ff00ff00ffU) * 6553601) >> 16;
+        value = ((value & 0x0000ffff0000ffffU) * 42949672960001U) >> 32;
+        return { len, value };
+    }
+
+    /**
+     * Parses the number at `it` into `value`, returning where it ends or null if there is none.
+     * Integral coordinates, the usual case, skip the general floating point parser, and read
+     * their first eight digits at once when the text has that many bytes left.
+     */
+    [[gnu::hot]] [[gnu::nothrow]]
+    static inline const char *number(const char *it, const char *end, double& value) noexcept {
+        const char *digits = it + (it < end && *it == '-');
+        uint64_t integral = 0;
+        const char *p = digits;
+        if (end - p >= 8) [[likely]] {
+            const auto [len, prefix] = eight_digits(p);
+            integral = prefix;
+            p += len;
+        }
+        while (p < end && p - digits < 15 && unsigned(*p - '0') < 10) {
+            integral = 10 * integral + unsigned(*p - '0');
+            p++;
+        }
+
+        const bool general = p < end && (*p == '.' || *p == 'e' || *p == 'E' || unsigned(*p - '0') < 10);
+        if (p > digits && !general) [[likely]] {
+            value = digits > it ? -double(integral) : double(integral);
+            return p;
+        }
+
+        const auto [next, error] = std::from_chars(it, end, value);
+        return error == std::errc() ? next : nullptr;
+    }
+
+    /** Parses `text`, with `path` only for the error messages. */
+    [[gnu::hot]]
+    static std::vector<vertex> parse(std::string_view text, const std::string& path = "<memory>") {
+        const char *it = text.data(), *end = text.data() + text.size();
+
+        auto vertices = std::vector<vertex>();
+        vertices.reserve(std::count(text.begin(), text.end(), '\n') + 1);
+
+        for (size_t line = 1; it < end; line++) {
+            it = skip_blank(it, end);
+            if (it == end) [[unlikely]] {
+                break;
+            } else if (*it == '\n') [[unlikely]] {
+                it++;
+                continue;
+            }
+
+            double coords[4];
+            for (double& coord : coords) {
+                it = number(skip_blank(it, end), end, coord);
+                if (!it) [[unlikely]] {
+                    throw utils::invalid_file::contains_invalid_data(path, line);
+                }
+            }
+
+            it = skip_blank(it, end);
+            if (it < end && *it != '\n') [[unlikely]] {
+                throw utils::invalid_file::contains_invalid_data(path, line);
+            }
+            it += it < end;
+
+            const auto id = unsigned(vertices.size() + 1);
+            vertices.push_back(vertex::with_id(id, coords[0], coords[1], coords[2], coords[3]));
+        }
+        return vertices;
+    }
+
+    [[gnu::cold]]
+    static instance load(const std::string& path) {
+        const auto file = mapped_file(path);
+        auto vertices = parse(file.contents(), path);
+        if (vertices.empty()) [[unlikely]] {
+            throw utils::invalid_file::is_empty_or_missing(path);
+        }
+        return instance(std::move(vertices));
+    }
+};
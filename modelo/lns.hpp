@@ -0,0 +1,548 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <gurobi_c++.h>
+#include "vertex.hpp"
+#include "tour.hpp"
+#include "instance.hpp"
+#include "patch.hpp"
+
+
+/** Incumbent edges with both ends outside of a window, which a reduced model keeps fixed. */
+struct window_edges final {
+public:
+    const utils::pair<std::vector<unsigned>> pos;
+    const std::vector<bool>& inside;
+
+    /** If `(u, v)` is an edge of incumbent `i`. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline bool adjacent(uint8_t i, unsigned u, unsigned v) const noexcept {
+        const unsigned pu = this->pos[i][u], pv = this->pos[i][v];
+        const unsigned diff = pu > pv ? pu - pv : pv - pu;
+        return diff == 1 || diff == this->pos[i].size() - 1;
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline bool contains(uint8_t i, unsigned u, unsigned v) const noexcept {
+        return !this->inside[u] && !this->inside[v] && this->adjacent(i, u, v);
+    }
+};
+
+
+/**
+ * One tour of a reduced model. Its fixed edges form paths between free vertices, the ones
+ * left with less than two of them, and each path is contracted to its ends, so the model
+ * only has the edges between free vertices.
+ */
+struct window_tour final {
+public:
+    /** Free vertices, by their index in the model. */
+    std::vector<unsigned> free;
+    /** Index in the model of each vertex, or -1 if it is not free. */
+    std::vector<int> local;
+    /** Other end of the fixed path at each free vertex, or the vertex itself if none. */
+    std::vector<unsigned> partner;
+
+    std::vector<GRBVar> vars;
+    /** Ends of the edge of each variable, by their index in the model. */
+    std::vector<std::pair<unsigned, unsigned>> edges;
+    /** Variable of each pair of free vertices, or -1 if the pair is fixed. */
+    std::vector<int> index;
+
+    [[gnu::cold]]
+    explicit inline window_tour(size_t n): local(n, -1) { }
+
+    /** Variable of the edge between the vertices `u` and `v`, or -1 if there is none. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline int find(unsigned u, unsigned v) const noexcept {
+        const int a = this->local[u], b = this->local[v];
+        if (a < 0 || b < 0) [[likely]] {
+            return -1;
+        }
+        return this->index[a * this->free.size() + b];
+    }
+};
+
+
+/**
+ * Subtour elimination for the reduced models. A fixed path joins its ends, so a set of
+ * free vertices holding `p` whole paths takes at most `|S| - 1 - p` free edges.
+ */
+struct window_cuts final : public GRBCallback {
+private:
+    const utils::pair<window_tour>& sides;
+
+    [[gnu::hot]]
+    void cut(const window_tour& w) {
+        const unsigned m = w.free.size();
+        if (w.vars.empty()) [[unlikely]] {
+            return;
+        }
+        const auto values = std::unique_ptr<double[]>(this->getSolution(w.vars.data(), int(w.vars.size())));
+
+        auto root = std::vector<unsigned>(m);
+        for (unsigned a = 0; a < m; a++) {
+            root[a] = a;
+        }
+        const auto find = [&root](unsigned a) {
+            while (root[a] != a) {
+                a = root[a] = root[root[a]];
+            }
+            return a;
+        };
+        for (unsigned a = 0; a < m; a++) {
+            root[find(a)] = find(w.partner[a]);
+        }
+        for (unsigned e = 0; e < w.vars.size(); e++) {
+            if (values[e] > 0.5) {
+                root[find(w.edges[e].first)] = find(w.edges[e].second);
+            }
+        }
+
+        auto size = std::vector<int>(m, 0);
+        auto paths = std::vector<int>(m, 0);
+        unsigned components = 0;
+        for (unsigned a = 0; a < m; a++) {
+            const unsigned r = find(a);
+            components += size[r] == 0;
+            size[r] += 1;
+            paths[r] += w.partner[a] > a;
+        }
+        if (components <= 1) [[likely]] {
+            return;
+        }
+
+        auto exprs = std::vector<GRBLinExpr>(m);
+        for (unsigned e = 0; e < w.vars.size(); e++) {
+            const unsigned r = find(w.edges[e].first);
+            if (r == find(w.edges[e].second)) {
+                exprs[r] += w.vars[e];
+            }
+        }
+        for (unsigned r = 0; r < m; r++) {
+            if (size[r] > 0) {
+                this->addLazy(exprs[r], GRB_LESS_EQUAL, size[r] - 1 - paths[r]);
+            }
+        }
+    }
+
+public:
+    [[gnu::cold]]
+    explicit inline window_cuts(const utils::pair<window_tour>& sides): GRBCallback(), sides(sides) { }
+
+protected:
+    [[gnu::hot]]
+    void callback() {
+        if (this->where == GRB_CB_MIPSOL) [[unlikely]] {
+            this->cut(this->sides[0]);
+            this->cut(this->sides[1]);
+        }
+    }
+};
+
+
+/**
+ * Large neighborhood search with a reduced exact model as the improvement operator. Each
+ * round frees a window of vertices, either the ball around a random vertex in one of the
+ * spaces or a stretch of one of the incumbent tours, fixes every incumbent edge outside
+ * of it and solves the model over the free vertices from the incumbent, under a short
+ * time limit.
+ */
+template <typename Metric>
+struct lns final {
+private:
+    const GRBEnv& env;
+    std::mt19937_64 rng;
+    utils::pair<tour> best;
+    double best_cost;
+
+    unsigned solved = 0;
+    unsigned improvements = 0;
+
+    std::optional<double> total_limit;
+    bool timed_out = false;
+
+    [[gnu::pure]] [[gnu::hot]]
+    inline double cost(const utils::pair<tour>& tours) const noexcept {
+        return tours[0].cost<Metric>(this->data.space(0)) + tours[1].cost<Metric>(this->data.space(1));
+    }
+
+    /** The `window` closest vertices to a random one, in a random space. */
+    [[gnu::hot]]
+    std::vector<bool> ball() {
+        const size_t n = this->order();
+        const uint8_t i = this->rng() & 1;
+        const auto& center = this->vertices[this->rng() % n][i];
+
+        auto order = std::vector<unsigned>(n);
+        for (unsigned v = 0; v < n; v++) {
+            order[v] = v;
+        }
+        const unsigned len = std::min<size_t>(this->window, n);
+        std::nth_element(order.begin(), order.begin() + (len - 1), order.end(), [&](unsigned a, unsigned b) {
+            return center.distance2(this->vertices[a][i]) < center.distance2(this->vertices[b][i]);
+        });
+
+        auto inside = std::vector<bool>(n, false);
+        for (unsigned p = 0; p < len; p++) {
+            inside[order[p]] = true;
+        }
+        return inside;
+    }
+
+    /** The `window` consecutive vertices of a random incumbent tour, from a random position. */
+    [[gnu::hot]]
+    std::vector<bool> segment() {
+        const size_t n = this->order();
+        const auto& t = this->best[this->rng() & 1];
+        const unsigned start = this->rng() % n;
+
+        auto inside = std::vector<bool>(n, false);
+        for (unsigned off = 0; off < std::min<size_t>(this->window, n); off++) {
+            inside[t[(start + off) % n]] = true;
+        }
+        return inside;
+    }
+
+    /** Position of each vertex in each incumbent tour, so fixed edges are found in O(1). */
+    [[gnu::hot]]
+    utils::pair<std::vector<unsigned>> positions() const {
+        auto pos = utils::pair<std::vector<unsigned>> { std::vector<unsigned>(this->order()), std::vector<unsigned>(this->order()) };
+        for (uint8_t i = 0; i <= 1; i++) {
+            for (unsigned p = 0; p < this->order(); p++) {
+                pos[i][this->best[i][p]] = p;
+            }
+        }
+        return pos;
+    }
+
+    /**
+     * Tour `i` of the model reduced to `inside`: one variable per pair of its free vertices,
+     * the degree of each one completed by its fixed path, and the incumbent as the start.
+     */
+    [[gnu::hot]]
+    window_tour side(GRBModel& model, uint8_t i, const std::vector<bool>& inside, const window_edges& fixed) const {
+        const size_t n = this->order();
+        const auto& t = this->best[i];
+        const auto space = this->data.space(i);
+        auto w = window_tour(n);
+
+        // a vertex is free when one of its incumbent edges touches the window
+        const auto is_free = [&](unsigned p) {
+            return inside[t[p]] || inside[t[(p + n - 1) % n]] || inside[t[(p + 1) % n]];
+        };
+        for (unsigned p = 0; p < n; p++) {
+            if (is_free(p)) [[unlikely]] {
+                w.local[t[p]] = int(w.free.size());
+                w.free.push_back(t[p]);
+            }
+        }
+        w.partner.resize(w.free.size());
+        for (unsigned a = 0; a < w.free.size(); a++) {
+            w.partner[a] = a;
+        }
+
+        // each fixed path starts at a free vertex whose next edge is outside of the window
+        for (unsigned p = 0; p < n; p++) {
+            if (!is_free(p) || !fixed.contains(i, t[p], t[(p + 1) % n])) [[likely]] {
+                continue;
+            }
+            unsigned q = (p + 1) % n;
+            while (!is_free(q)) {
+                q = (q + 1) % n;
+            }
+            const unsigned a = w.local[t[p]], b = w.local[t[q]];
+            w.partner[a] = b;
+            w.partner[b] = a;
+        }
+
+        const unsigned m = w.free.size();
+        w.index.assign(size_t(m) * m, -1);
+        for (unsigned a = 0; a < m; a++) {
+            auto degree = GRBLinExpr();
+            for (unsigned b = 0; b < m; b++) {
+                const unsigned u = w.free[a], v = w.free[b];
+                if (a == b || fixed.contains(i, u, v)) [[unlikely]] {
+                    continue;
+                }
+                if (a < b) {
+                    auto x = model.addVar(0., 1., space.cost<Metric>(u, v), GRB_BINARY);
+                    x.set(GRB_DoubleAttr_Start, fixed.adjacent(i, u, v) ? 1.0 : 0.0);
+                    w.index[a * m + b] = w.index[b * m + a] = int(w.vars.size());
+                    w.vars.push_back(x);
+                    w.edges.emplace_back(a, b);
+                }
+                degree += w.vars[w.index[a * m + b]];
+            }
+            model.addConstr(degree, GRB_EQUAL, w.partner[a] == a ? 2. : 1.);
+        }
+        return w;
+    }
+
+    /**
+     * Shared edges of the reduced pair: the ones fixed in both tours are a constant, the
+     * ones fixed in one tour count when the other chooses them, and the rest need both.
+     */
+    [[gnu::hot]]
+    void add_similarity(GRBModel& model, const utils::pair<window_tour>& sides, const window_edges& fixed) const {
+        const size_t n = this->order();
+        const auto& t = this->best[0];
+        double constant = 0.0;
+        for (unsigned p = 0; p < n; p++) {
+            const unsigned u = t[p], v = t[(p + 1) % n];
+            constant += fixed.contains(0, u, v) && fixed.contains(1, u, v);
+        }
+
+        auto expr = GRBLinExpr();
+        for (uint8_t i = 0; i <= 1; i++) {
+            const auto& w = sides[i];
+            const auto& other = sides[1 - i];
+            for (unsigned e = 0; e < w.vars.size(); e++) {
+                const unsigned u = w.free[w.edges[e].first], v = w.free[w.edges[e].second];
+                if (fixed.contains(1 - i, u, v)) [[unlikely]] {
+                    expr += w.vars[e];
+                    continue;
+                }
+
+                // pairs free in both tours are counted once, from the first
+                const int f = other.find(u, v);
+                if (i == 1 || f < 0) [[likely]] {
+                    continue;
+                }
+                auto both = model.addVar(0., 1., 0., GRB_CONTINUOUS);
+                model.addConstr(both, GRB_LESS_EQUAL, w.vars[e]);
+                model.addConstr(both, GRB_LESS_EQUAL, other.vars[f]);
+                expr += both;
+            }
+        }
+        model.addConstr(expr, GRB_GREATER_EQUAL, double(this->k) - constant);
+    }
+
+    /** Tour `i` of the reduced solution: its fixed edges and the free ones set in `values`. */
+    [[gnu::hot]]
+    std::optional<tour> rebuild(uint8_t i, const window_tour& w, const double *values, const window_edges& fixed) const {
+        const size_t n = this->order();
+        const auto& t = this->best[i];
+        auto next = std::vector<std::array<unsigned, 2>>(n);
+        auto degree = std::vector<unsigned>(n, 0);
+        const auto link = [&](unsigned u, unsigned v) {
+            if (degree[u] >= 2 || degree[v] >= 2) [[unlikely]] {
+                return false;
+            }
+            next[u][degree[u]++] = v;
+            next[v][degree[v]++] = u;
+            return true;
+        };
+
+        for (unsigned p = 0; p < n; p++) {
+            const unsigned u = t[p], v = t[(p + 1) % n];
+            if (fixed.contains(i, u, v) && !link(u, v)) [[unlikely]] {
+                return std::nullopt;
+            }
+        }
+        for (unsigned e = 0; e < w.vars.size(); e++) {
+            if (values[e] > 0.5 && !link(w.free[w.edges[e].first], w.free[w.edges[e].second])) [[unlikely]] {
+                return std::nullopt;
+            }
+        }
+
+        auto result = tour();
+        result.reserve(n);
+        unsigned prev = n, u = 0;
+        for (unsigned len = 0; len < n; len++) {
+            if (degree[u] != 2 || (len > 0 && u == 0)) [[unlikely]] {
+                return std::nullopt;
+            }
+            result.push_back(u);
+            const unsigned v = next[u][0] != prev ? next[u][0] : next[u][1];
+            prev = u;
+            u = v;
+        }
+        if (u != 0) [[unlikely]] {
+            return std::nullopt;
+        }
+        return result;
+    }
+
+    /**
+     * Solves the model reduced to `inside`, replacing the incumbent if it improves. Only
+     * the free vertices of each tour are in it, so it costs the same whatever the size.
+     */
+    [[gnu::hot]]
+    void round(const std::vector<bool>& inside) {
+        const double remaining = this->total_limit ? *this->total_limit - this->elapsed() : this->limit;
+        if (remaining <= 0.0) [[unlikely]] {
+            return;
+        }
+
+        const auto fixed = window_edges { this->positions(), inside };
+        auto model = GRBModel(this->env);
+        auto sides = utils::pair<window_tour> {
+            this->side(model, 0, inside, fixed),
+            this->side(model, 1, inside, fixed),
+        };
+        if (this->k > 0) {
+            this->add_similarity(model, sides, fixed);
+        }
+        model.set(GRB_DoubleParam_TimeLimit, std::min(this->limit, remaining));
+
+        auto cuts = window_cuts(sides);
+        model.setCallback(&cuts);
+        model.optimize();
+        if (model.get(GRB_IntAttr_SolCount) <= 0) [[unlikely]] {
+            return;
+        }
+        this->solved += 1;
+
+        auto tours = utils::pair<tour>();
+        for (uint8_t i = 0; i <= 1; i++) {
+            const auto& w = sides[i];
+            const auto values = std::unique_ptr<double[]>(w.vars.empty() ? nullptr : model.get(GRB_DoubleAttr_X, w.vars.data(), int(w.vars.size())));
+            auto t = this->rebuild(i, w, values.get(), fixed);
+            if (!t) [[unlikely]] {
+                return;
+            }
+            tours[i] = std::move(*t);
+        }
+
+        const double cost = this->cost(tours);
+        if (cost < this->best_cost - 0.5) [[unlikely]] {
+            this->best = std::move(tours);
+            this->best_cost = cost;
+            this->improvements += 1;
+        }
+    }
+
+public:
+    /** Starts from `initial`, a `k`-similar pair of tours over `vertices`. */
+    [[gnu::cold]]
+    lns(
+        const instance& data,
+        const GRBEnv& env,
+        unsigned k,
+        const utils::pair<tour>& initial,
+        unsigned rounds = 50,
+        unsigned window = 30,
+        double limit = 2.0,
+        uint64_t seed = 0
+    ):
+        env(env), rng(seed), best(initial), best_cost(0.0),
+        data(data), vertices(data.vertices()), k(k), rounds(rounds), window(window), limit(limit)
+    {
+        this->best_cost = this->cost(this->best);
+    }
+
+    /** Shared by every sub-MIP, so each space is tabulated once. */
+    const instance data;
+    const std::span<const vertex> vertices;
+    /** Minimum number of shared edges between tours. */
+    const unsigned k;
+    /** Number of sub-MIPs to solve. */
+    const unsigned rounds;
+    /** Number of vertices freed in each sub-MIP. */
+    const unsigned window;
+    /** Time limit of each sub-MIP, in seconds. */
+    const double limit;
+
+    /** Number of vertices. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline size_t order() const noexcept {
+        return this->vertices.size();
+    }
+
+    /** Number of edges. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline size_t size() const noexcept {
+        const size_t order = this->order();
+        return (order * (order - 1)) / 2;
+    }
+
+    using clock = std::chrono::high_resolution_clock;
+    const clock::time_point start = clock::now();
+
+    [[gnu::cold]] [[gnu::nothrow]]
+    inline double elapsed() const noexcept {
+        auto end = clock::now();
+        std::chrono::duration<double> secs = end - this->start;
+        return secs.count();
+    }
+
+    /** Stops `solve` after `secs` seconds, keeping the best pair found so far. */
+    [[gnu::cold]]
+    void time_limit(double secs) {
+        this->total_limit = secs;
+    }
+
+    [[gnu::hot]]
+    double solve() {
+        if (this->order() < 8) [[unlikely]] {
+            return this->elapsed();
+        }
+
+        for (unsigned r = 0; r < this->rounds; r++) {
+            if (this->total_limit && this->elapsed() >= *this->total_limit) [[unlikely]] {
+                this->timed_out = true;
+                break;
+            }
+            const auto inside = r % 2 == 0 ? this->ball() : this->segment();
+            this->round(inside);
+        }
+        return this->elapsed();
+    }
+
+    /** Number of times the incumbent improved, counting the initial one. */
+    [[gnu::pure]] [[gnu::cold]]
+    int64_t solution_count() const {
+        return this->improvements + 1;
+    }
+
+    /** Why `solve` stopped. */
+    [[gnu::pure]] [[gnu::cold]]
+    std::string_view status() const {
+        return this->timed_out ? "time limit" : "round limit";
+    }
+
+    /** Sub-MIPs that returned a solution. */
+    [[gnu::pure]] [[gnu::cold]]
+    int64_t iterations() const {
+        return this->solved;
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    double solution_cost() const {
+        return this->best_cost;
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    unsigned similarity() const {
+        return patch<Metric>::shared(this->best[0], this->best[1]);
+    }
+
+    /** Best pair found, as indices into `vertices`. */
+    [[gnu::pure]] [[gnu::cold]]
+    const utils::pair<tour>& tours() const {
+        return this->best;
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    auto solution(uint8_t i) const {
+        auto vertices = std::vector<vertex>();
+        vertices.reserve(this->order());
+
+        for (unsigned v : this->best[i]) {
+            vertices.push_back(this->vertices[v]);
+        }
+        return vertices;
+    }
+};
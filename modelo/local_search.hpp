@@ -0,0 +1,604 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "vertex.hpp"
+#include "tour.hpp"
+
+
+namespace utils {
+    /** Lin-Kernighan chains of up to five steps, so sequential moves of up to 6-opt. */
+    constexpr unsigned lk_depth = 5;
+
+    /** Point in time at which the searches stop early, keeping what they have, if any. */
+    struct deadline final {
+    public:
+        using clock = std::chrono::steady_clock;
+        std::optional<clock::time_point> at;
+
+        /** `secs` seconds from now, or never if there is no limit. */
+        [[gnu::cold]]
+        static deadline in(std::optional<double> secs) {
+            if (!secs) [[likely]] {
+                return deadline();
+            }
+            const auto left = std::chrono::duration<double>(std::max(0.0, *secs));
+            return deadline { clock::now() + std::chrono::duration_cast<clock::duration>(left) };
+        }
+
+        [[gnu::hot]] [[gnu::nothrow]]
+        inline bool passed() const noexcept {
+            return this->at && clock::now() >= *this->at;
+        }
+    };
+
+    /** Edge costs of one coordinate space under `Metric`, over its contiguous coordinate arrays. */
+    template <typename Metric>
+    struct space_cost final {
+    public:
+        const plane space;
+
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline double operator()(unsigned u, unsigned v) const noexcept {
+            return this->space.cost<Metric>(u, v);
+        }
+    };
+
+    /** No similarity to keep, so every move is allowed. */
+    struct unconstrained final {
+    public:
+        [[gnu::const]] [[gnu::hot]] [[gnu::nothrow]]
+        constexpr bool contains(unsigned, unsigned) const noexcept {
+            return false;
+        }
+
+        [[gnu::const]] [[gnu::hot]] [[gnu::nothrow]]
+        constexpr bool allows(int) const noexcept {
+            return true;
+        }
+
+        [[gnu::hot]] [[gnu::nothrow]]
+        constexpr void apply(int) noexcept { }
+    };
+
+    /**
+     * Edges of the other tour of a pair, from the position of each vertex in it, so a move
+     * on this tour knows in O(1) how many shared edges it creates or breaks.
+     */
+    struct shared_edges final {
+    public:
+        const std::span<const unsigned> pos;
+        /** Minimum number of shared edges. */
+        const unsigned k;
+        /** Edges currently shared by both tours. */
+        unsigned count;
+
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline bool contains(unsigned u, unsigned v) const noexcept {
+            const unsigned pu = this->pos[u], pv = this->pos[v];
+            const unsigned diff = pu > pv ? pu - pv : pv - pu;
+            return diff == 1 || diff == this->pos.size() - 1;
+        }
+
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline bool allows(int delta) const noexcept {
+            return int(this->count) + delta >= int(this->k);
+        }
+
+        [[gnu::hot]] [[gnu::nothrow]]
+        inline void apply(int delta) noexcept {
+            this->count += delta;
+        }
+    };
+}
+
+
+/** Candidate lists: the `width` closest vertices to each vertex, by distance in one space or any other key. */
+struct neighbors final {
+private:
+    /** Only for lists computed here, shared by every copy. */
+    std::shared_ptr<const std::vector<unsigned>> storage;
+    std::span<const unsigned> list;
+
+    [[gnu::cold]] [[gnu::nothrow]]
+    inline neighbors(std::shared_ptr<const std::vector<unsigned>> storage, std::span<const unsigned> list, unsigned width) noexcept:
+        storage(std::move(storage)), list(list), width(width)
+    { }
+
+public:
+    const unsigned width;
+
+    /**
+     * The `width` vertices `v` with the smallest `key(u, v)` for each `u`. The key is called
+     * for every `v` of one `u` before moving to the next, so it may compute a row at a time.
+     */
+    template <typename Key>
+    [[gnu::hot]]
+    static neighbors smallest(size_t n, unsigned width, Key&& key) {
+        width = std::min<unsigned>(width, n > 0 ? n - 1 : 0);
+        auto lists = std::make_shared<std::vector<unsigned>>(n * width);
+        if (width == 0) [[unlikely]] {
+            return neighbors(std::move(lists), {}, width);
+        }
+
+        // kept sorted by key, only the last one needs to be compared
+        auto best = std::vector<std::pair<double, unsigned>>(width);
+        for (unsigned u = 0; u < n; u++) {
+            unsigned filled = 0;
+
+            for (unsigned v = 0; v < n; v++) {
+                if (u == v) [[unlikely]] {
+                    continue;
+                }
+                const double dist = key(u, v);
+                if (filled == width && dist >= best[width - 1].first) [[likely]] {
+                    continue;
+                }
+
+                unsigned at = filled < width ? filled++ : width - 1;
+                for (; at > 0 && best[at - 1].first > dist; at--) {
+                    best[at] = best[at - 1];
+                }
+                best[at] = std::make_pair(dist, v);
+            }
+
+            for (unsigned w = 0; w < width; w++) {
+                (*lists)[u * width + w] = best[w].second;
+            }
+        }
+        const auto list = std::span<const unsigned>(*lists);
+        return neighbors(std::move(lists), list, width);
+    }
+
+    /**
+     * Lists computed elsewhere, `width` consecutive candidates for each vertex, read in place,
+     * such as the ones stored in a binary instance. They must outlive every copy.
+     */
+    [[gnu::cold]] [[gnu::nothrow]]
+    static neighbors view(std::span<const unsigned> lists, unsigned width) noexcept {
+        return neighbors(nullptr, lists, width);
+    }
+
+    template <typename Metric>
+    [[gnu::hot]]
+    static neighbors nearest(const utils::plane& space, unsigned width = 10) {
+        return smallest(space.size(), width, [&space](unsigned u, unsigned v) {
+            return space.key<Metric>(u, v);
+        });
+    }
+
+    template <typename Metric>
+    [[gnu::hot]]
+    static neighbors nearest(std::span<const vertex> vertices, uint8_t i, unsigned width = 10) {
+        return nearest<Metric>(utils::columns(vertices)[i], width);
+    }
+
+    /** If `v` is a candidate of `u` or the other way around. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline bool contains(unsigned u, unsigned v) const noexcept {
+        const auto of_u = (*this)[u], of_v = (*this)[v];
+        return std::find(of_u.begin(), of_u.end(), v) != of_u.end()
+            || std::find(of_v.begin(), of_v.end(), u) != of_v.end();
+    }
+
+    /** Edges of `t` between candidates. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    unsigned covers(const tour& t) const noexcept {
+        unsigned total = 0;
+        for (unsigned p = 0; p < t.size(); p++) {
+            total += this->contains(t[p], t[(p + 1) % t.size()]);
+        }
+        return total;
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline std::span<const unsigned> operator[](unsigned u) const noexcept {
+        return this->list.subspan(u * this->width, this->width);
+    }
+};
+
+
+/**
+ * 2-opt, Or-opt and Lin-Kernighan descent over candidate lists, with don't-look bits. The
+ * tour is kept as an array with the position of each vertex, and 2-opt moves reverse the
+ * shorter side of the tour, so each move costs O(1) to evaluate and at most O(n/2) to apply.
+ * Moves that `Shared` does not allow, for leaving too few edges in common with another
+ * tour, are skipped.
+ */
+template <typename Distance, typename Shared = utils::unconstrained>
+struct local_search final {
+private:
+    const Distance cost;
+    const neighbors& near;
+    const unsigned depth;
+    Shared shared;
+    const utils::deadline stop;
+
+    tour order;
+    std::vector<unsigned> pos;
+
+    std::vector<bool> active;
+    std::vector<unsigned> queue;
+    size_t head = 0;
+
+    uint64_t evaluated = 0;
+    uint64_t applied = 0;
+    uint64_t improved = 0;
+
+    /** Steps `(t1, t2, t3, t4)` of the current Lin-Kernighan chain. */
+    std::vector<std::array<unsigned, 4>> chain;
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline size_t count() const noexcept {
+        return this->order.size();
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline unsigned succ(unsigned v) const noexcept {
+        const unsigned p = this->pos[v] + 1;
+        return this->order[p == this->count() ? 0 : p];
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline unsigned pred(unsigned v) const noexcept {
+        const unsigned p = this->pos[v];
+        return this->order[p == 0 ? this->count() - 1 : p - 1];
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline unsigned next(unsigned v, bool forward) const noexcept {
+        return forward ? this->succ(v) : this->pred(v);
+    }
+
+    /** Reverses the path going forward from `from` to `to`, or its complement if shorter. */
+    [[gnu::hot]]
+    void reverse(unsigned from, unsigned to) noexcept {
+        const unsigned n = this->count();
+        unsigned i = this->pos[from], j = this->pos[to];
+        unsigned len = (j + n - i) % n + 1;
+
+        if (2 * len > n) {
+            i = this->pos[this->succ(to)];
+            j = this->pos[this->pred(from)];
+            len = n - len;
+        }
+
+        for (unsigned step = 0; step < len / 2; step++) {
+            const unsigned u = this->order[i], v = this->order[j];
+            this->order[i] = v;
+            this->pos[v] = i;
+            this->order[j] = u;
+            this->pos[u] = j;
+
+            i = (i + 1 == n) ? 0 : i + 1;
+            j = (j == 0) ? n - 1 : j - 1;
+        }
+    }
+
+    /** Replaces edges `(a, b)` and `(c, d)`, oriented the same way, by `(a, c)` and `(b, d)`. */
+    [[gnu::hot]]
+    inline void move_2opt(unsigned a, unsigned b, unsigned c, unsigned d) noexcept {
+        if (this->succ(a) == b) {
+            this->reverse(b, c);
+        } else {
+            this->reverse(a, d);
+        }
+        this->applied += 1;
+    }
+
+    [[gnu::hot]]
+    bool try_2opt(unsigned a) {
+        for (const bool forward : { true, false }) {
+            const unsigned b = this->next(a, forward);
+            const double ab = this->cost(a, b);
+
+            for (const unsigned c : this->near[a]) {
+                const double ac = this->cost(a, c);
+                if (ac >= ab) [[unlikely]] {
+                    break;
+                }
+                const unsigned d = this->next(c, forward);
+                if (c == b || d == a) [[unlikely]] {
+                    continue;
+                }
+
+                this->evaluated += 1;
+                const double delta = ac + this->cost(b, d) - ab - this->cost(c, d);
+                if (delta < -1e-9) [[unlikely]] {
+                    const int sdelta = this->in_shared(a, c) + this->in_shared(b, d)
+                        - this->in_shared(a, b) - this->in_shared(c, d);
+                    if (!this->shared.allows(sdelta)) [[unlikely]] {
+                        continue;
+                    }
+
+                    this->shared.apply(sdelta);
+                    this->move_2opt(a, b, c, d);
+                    this->activate({ a, b, c, d });
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Moves the segment `s1..s2`, with `s2` following `s1` in the tour, between `c` and
+     * `d = succ(c)`, either as `c s1..s2 d` (straight) or `c s2..s1 d`.
+     */
+    [[gnu::hot]]
+    void move_segment(unsigned s1, unsigned s2, unsigned c, unsigned d, bool straight) noexcept {
+        const unsigned p = this->pred(s1), n1 = this->succ(s2);
+
+        this->move_2opt(p, s1, c, d);
+        this->move_2opt(p, c, n1, s2);
+        if (straight) {
+            this->move_2opt(c, s2, s1, d);
+        }
+    }
+
+    [[gnu::hot]]
+    bool try_or_opt(unsigned a) {
+        for (const bool forward : { true, false }) {
+            unsigned s2 = a;
+            for (unsigned len = 1; len <= 3 && len + 3 < this->count(); len++) {
+                if (len > 1) {
+                    s2 = this->next(s2, forward);
+                }
+                if (this->try_or_opt(a, s2, len, forward)) [[unlikely]] {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline bool in_segment(unsigned v, unsigned s1, unsigned len, bool forward) const noexcept {
+        const unsigned n = this->count();
+        const unsigned off = forward ? (this->pos[v] + n - this->pos[s1]) % n : (this->pos[s1] + n - this->pos[v]) % n;
+        return off < len;
+    }
+
+    [[gnu::hot]]
+    bool try_or_opt(unsigned s1, unsigned s2, unsigned len, bool forward) {
+        const unsigned p = this->next(s1, !forward), n1 = this->next(s2, forward);
+        const double removed = this->cost(p, s1) + this->cost(s2, n1) - this->cost(p, n1);
+        if (removed <= 1e-9) [[likely]] {
+            return false;
+        }
+
+        for (const unsigned c : this->near[s1]) {
+            const double cs1 = this->cost(c, s1);
+            if (cs1 >= removed) [[unlikely]] {
+                break;
+            }
+            if (c == p || c == n1 || this->in_segment(c, s1, len, forward)) [[unlikely]] {
+                continue;
+            }
+
+            for (const bool after : { true, false }) {
+                // after: c s1..s2 d, otherwise d s2..s1 c, both along `forward`
+                const unsigned d = this->next(c, after == forward);
+                if (d == p || d == n1 || this->in_segment(d, s1, len, forward)) [[unlikely]] {
+                    continue;
+                }
+
+                this->evaluated += 1;
+                const double delta = cs1 + this->cost(s2, d) - this->cost(c, d) - removed;
+                if (delta < -1e-9) [[unlikely]] {
+                    const int sdelta = this->in_shared(p, n1) + this->in_shared(c, s1) + this->in_shared(s2, d)
+                        - this->in_shared(p, s1) - this->in_shared(s2, n1) - this->in_shared(c, d);
+                    if (!this->shared.allows(sdelta)) [[unlikely]] {
+                        continue;
+                    }
+
+                    this->shared.apply(sdelta);
+                    const unsigned fs1 = forward ? s1 : s2, fs2 = forward ? s2 : s1;
+                    const bool cd = this->succ(c) == d;
+                    const unsigned fc = cd ? c : d, fd = cd ? d : c;
+
+                    this->move_segment(fs1, fs2, fc, fd, fc == c ? fs1 == s1 : fs1 == s2);
+                    this->activate({ p, n1, s1, s2, c, d });
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline int in_shared(unsigned u, unsigned v) const noexcept {
+        return int(this->shared.contains(u, v));
+    }
+
+    /** If `(u, v)` was added by an earlier step of the current chain. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline bool in_chain(unsigned u, unsigned v) const noexcept {
+        for (const auto& [t1, t2, t3, t4] : this->chain) {
+            if ((t2 == u && t3 == v) || (t2 == v && t3 == u)) [[unlikely]] {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * One step of a Lin-Kernighan chain from `t1`, whose edge to `t2` is being removed with
+     * `gain` and `sgain` shared edges accumulated so far. Each step adds `(t2, t3)` for a
+     * candidate `t3`, removes `(t3, t4)` and closes the tour with `(t4, t1)` as a 2-opt move,
+     * which is kept as soon as the closed tour is cheaper, extended while the gain stays
+     * positive, or undone.
+     */
+    [[gnu::hot]]
+    bool lk_step(unsigned t1, unsigned t2, double gain, int sgain, unsigned level) {
+        const unsigned breadth = level == 1 ? 5 : level == 2 ? 3 : 1;
+        unsigned tried = 0;
+
+        for (const unsigned t3 : this->near[t2]) {
+            const double g1 = gain - this->cost(t2, t3);
+            if (g1 <= 1e-9) [[unlikely]] {
+                break;
+            }
+            // undoing a step may reverse the other side of the tour, so the orientation is not fixed
+            const bool forward = this->succ(t1) == t2;
+            const unsigned t4 = this->next(t3, !forward);
+            if (t3 == t1 || t4 == t2 || this->in_chain(t3, t4)) [[unlikely]] {
+                continue;
+            }
+
+            this->evaluated += 1;
+            const double g2 = g1 + this->cost(t3, t4);
+            const int s2 = sgain + this->in_shared(t2, t3) - this->in_shared(t3, t4);
+            this->move_2opt(t1, t2, t4, t3);
+            this->chain.push_back({ t1, t2, t3, t4 });
+
+            const int closed = s2 + this->in_shared(t4, t1);
+            if (g2 - this->cost(t4, t1) > 1e-9 && this->shared.allows(closed)) [[unlikely]] {
+                this->shared.apply(closed);
+                return true;
+            }
+            if (level < this->depth && this->lk_step(t1, t4, g2, s2, level + 1)) [[unlikely]] {
+                return true;
+            }
+
+            this->chain.pop_back();
+            this->move_2opt(t1, t4, t2, t3);
+            if (++tried >= breadth) [[unlikely]] {
+                break;
+            }
+        }
+        return false;
+    }
+
+    [[gnu::hot]]
+    bool try_lk(unsigned t1) {
+        if (this->depth < 2) [[unlikely]] {
+            return false;
+        }
+
+        for (const bool forward : { true, false }) {
+            const unsigned t2 = this->next(t1, forward);
+            this->chain.clear();
+
+            if (this->lk_step(t1, t2, this->cost(t1, t2), -this->in_shared(t1, t2), 1)) [[unlikely]] {
+                for (const auto& [s1, s2, s3, s4] : this->chain) {
+                    this->activate({ s1, s2, s3, s4 });
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    [[gnu::hot]]
+    inline void activate(std::initializer_list<unsigned> vertices) {
+        for (const unsigned v : vertices) {
+            this->activate(v);
+        }
+    }
+
+public:
+    [[gnu::cold]]
+    local_search(
+        Distance cost,
+        const neighbors& near,
+        const tour& initial,
+        unsigned depth = utils::lk_depth,
+        Shared shared = Shared(),
+        utils::deadline stop = utils::deadline()
+    ):
+        cost(cost), near(near), depth(depth), shared(shared), stop(stop), order(initial), pos(initial.size()),
+        active(initial.size(), false)
+    {
+        for (unsigned p = 0; p < this->count(); p++) {
+            this->pos[this->order[p]] = p;
+        }
+        this->queue.reserve(initial.size());
+    }
+
+    /** Clears the don't-look bit of `v`, so it is tried again. */
+    [[gnu::hot]]
+    inline void activate(unsigned v) {
+        if (!this->active[v]) [[likely]] {
+            this->active[v] = true;
+            this->queue.push_back(v);
+        }
+    }
+
+    [[gnu::hot]]
+    inline void activate_all() {
+        for (const unsigned v : this->order) {
+            this->activate(v);
+        }
+    }
+
+    /** Runs until every vertex has its don't-look bit set, or until the deadline passes. */
+    [[gnu::hot]]
+    void optimize() {
+        if (this->count() < 8) [[unlikely]] {
+            this->queue.clear();
+            std::fill(this->active.begin(), this->active.end(), false);
+            return;
+        }
+
+        while (this->head < this->queue.size()) [[likely]] {
+            // the clock is read once every few hundred vertices, so it costs nothing per move
+            if (this->head % 256 == 0 && this->stop.passed()) [[unlikely]] {
+                std::fill(this->active.begin(), this->active.end(), false);
+                break;
+            }
+            const unsigned a = this->queue[this->head++];
+            this->active[a] = false;
+
+            if (this->try_2opt(a) || this->try_or_opt(a) || this->try_lk(a)) [[unlikely]] {
+                this->improved += 1;
+                this->activate(a);
+            }
+
+            if (this->head > this->count() && 2 * this->head > this->queue.size()) [[unlikely]] {
+                this->queue.erase(this->queue.begin(), this->queue.begin() + this->head);
+                this->head = 0;
+            }
+        }
+        this->queue.clear();
+        this->head = 0;
+    }
+
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline const tour& result() const noexcept {
+        return this->order;
+    }
+
+    /** Improving moves kept. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline uint64_t improvements() const noexcept {
+        return this->improved;
+    }
+
+    /** Edges shared with the other tour, as tracked by `Shared`. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline const Shared& similarity() const noexcept {
+        return this->shared;
+    }
+
+    /** Moves whose cost change was computed. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline uint64_t evaluations() const noexcept {
+        return this->evaluated;
+    }
+
+    /** 2-opt moves applied, counting the ones used to build Or-opt moves and Lin-Kernighan steps. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline uint64_t moves() const noexcept {
+        return this->applied;
+    }
+};
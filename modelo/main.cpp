@@ -1,27 +1,51 @@
+#include <algorithm>
 #include <chrono>
-#include <csignal>
+#include <filesystem>
+#include <memory>
 #include <optional>
 #include <span>
 #include <stdexcept>
-#include <unistd.h>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <variant>
 #include <vector>
 
+#ifndef HEURISTIC_ONLY
 #include "graph.hpp"
+#include "lns.hpp"
+#include "benders.hpp"
+#endif
+#include "heuristic.hpp"
+#include "held_karp.hpp"
+#include "pruning.hpp"
 #include "coordinates.hpp"
+#include "instance.hpp"
+#include "tsplib.hpp"
+#include "binary.hpp"
+#include "generator.hpp"
 #include "argparse.hpp"
 
 
+#ifndef HEURISTIC_ONLY
 namespace utils {
+    /** Environment shared by every model, with `threads` zero meaning all cores. */
     [[gnu::cold]]
-    static GRBEnv quiet_env() {
+    static GRBEnv quiet_env(unsigned threads = 0, unsigned concurrent = 1, unsigned seed = 0) {
         auto env = GRBEnv(true);
         env.set(GRB_IntParam_OutputFlag, 0);
         env.set(GRB_IntParam_LazyConstraints, 1);
+        env.set(GRB_IntParam_Threads, int(threads));
+        env.set(GRB_IntParam_Seed, int(seed));
+        if (concurrent > 1) [[unlikely]] {
+            env.set(GRB_IntParam_ConcurrentMIP, int(concurrent));
+        }
         env.start();
         return env;
     }
 }
+#endif
 
 struct program final {
 private:
@@ -30,17 +54,41 @@ private:
     [[gnu::cold]]
     explicit inline program(std::string name): args(name) {
         this->args.add_argument("-n", "--nodes")
-            .help("sample size for the subgraph")
+            .help("sample size for the subgraph, every vertex of the instance if zero")
             .default_value<unsigned>(100)
             .scan<'u', unsigned>();
 
+        this->args.add_argument("--instance")
+            .help("read the vertices from this file, one 'x1 y1 x2 y2' line each, TSPLIB if '.tsp' or mapped if '.bin', instead of the embedded ones");
+
+        this->args.add_argument("--generate")
+            .help("use 'n,seed,dist' random vertices instead, with dist 'uniform', 'clustered' or 'correlated[,rho]', ignoring '-n'");
+
+        this->args.add_argument("--convert")
+            .help("write the vertices to this binary instance and exit, with candidate lists of '--candidate-width' if positive");
+
+        this->args.add_argument("--metric")
+            .help("edge costs 'CEIL_2D', 'EUC_2D', 'ATT' or 'GEO', overriding the one of the instance, 'CEIL_2D' if it has none")
+            .action([](const std::string& value) {
+                if (!metric::named(value)) [[unlikely]] {
+                    throw std::runtime_error("--metric: expected 'CEIL_2D', 'EUC_2D', 'ATT' or 'GEO', got '" + value + "'");
+                }
+                return value;
+            });
+
+        this->args.add_argument("--second-space")
+            .help("TSPLIB file with the coordinates of the second space, pairing its nodes in order with '--instance'");
+
+        this->args.add_argument("--tour-files")
+            .help("write each final tour as a TSPLIB tour file, named by this prefix and the space");
+
         this->args.add_argument("-k", "--similarity")
             .help("minimun number of shared edges between tours")
             .default_value<unsigned>(0)
             .scan<'u', unsigned>();
 
         this->args.add_argument("--timeout")
-            .help("execution timeout (in minutes), disabled if zero or negative")
+            .help("time limit (in minutes) after which the best solution found is reported, disabled if zero or negative")
             .default_value<double>(30.0)
             .scan<'g', double>();
 
@@ -48,25 +96,233 @@ private:
             .help("show vertices present on each solution")
             .default_value(false)
             .implicit_value(true);
+
+        this->args.add_argument("--heuristic")
+            .help("run the iterated local search instead of the exact model (no Gurobi needed)")
+            .default_value(false)
+            .implicit_value(true);
+
+        this->args.add_argument("--bound")
+            .help("compute the Held-Karp lower bound of each tour before solving")
+            .default_value(false)
+            .implicit_value(true);
+
+        this->args.add_argument("--candidates")
+            .help("candidate lists for the local search and the sparse model, 'nearest' or 'alpha'")
+            .default_value(std::string("nearest"))
+            .action([](const std::string& value) {
+                if (value != "nearest" && value != "alpha") [[unlikely]] {
+                    throw std::runtime_error("--candidates: expected 'nearest' or 'alpha', got '" + value + "'");
+                }
+                return value;
+            });
+
+        this->args.add_argument("--candidate-width")
+            .help("number of candidates kept for each vertex")
+            .default_value<unsigned>(10)
+            .scan<'u', unsigned>();
+
+        this->args.add_argument("--coverage")
+            .help("show how many edges of the final tours each candidate set covers")
+            .default_value(false)
+            .implicit_value(true);
+
+        this->args.add_argument("--kicks")
+            .help("number of double bridge kicks tried by the heuristic")
+            .default_value<unsigned>(1000)
+            .scan<'u', unsigned>();
+
+        this->args.add_argument("--depth")
+            .help("maximum steps of the Lin-Kernighan chains in the local search, disabled below 2")
+            .default_value<unsigned>(unsigned(utils::lk_depth))
+            .scan<'u', unsigned>();
+
+        this->args.add_argument("--seed")
+            .help("random seed of the solver, of the heuristic kicks and of the LNS windows")
+            .default_value<unsigned>(0)
+            .scan<'u', unsigned>();
+
+#ifndef HEURISTIC_ONLY
+        // only the exact model, the LNS and the decomposition read these
+        this->args.add_argument("-m", "--tours")
+            .help("number of k-similar tours of the exact model, 2 to 4, the ones past the second taking turns in the two coordinate spaces")
+            .default_value<unsigned>(2)
+            .scan<'u', unsigned>();
+
+        this->args.add_argument("--sharing")
+            .help("how the exact model counts the '-k' shared edges, 'pairwise' between each two tours or 'common' to all, which is linear")
+            .default_value(std::string("pairwise"))
+            .action([](const std::string& value) {
+                if (value != "pairwise" && value != "common") [[unlikely]] {
+                    throw std::runtime_error("--sharing: expected 'pairwise' or 'common', got '" + value + "'");
+                }
+                return value;
+            });
+
+        this->args.add_argument("--sparse")
+            .help("build the exact model only over candidate edges (no longer exact)")
+            .default_value(false)
+            .implicit_value(true);
+
+        this->args.add_argument("--eliminate")
+            .help("run the heuristic first and drop the edges its Held-Karp bounds prove useless from the exact model")
+            .default_value(false)
+            .implicit_value(true);
+
+        this->args.add_argument("--mip-start")
+            .help("run the heuristic first and hand its tours to the exact model as a MIP start")
+            .default_value(false)
+            .implicit_value(true);
+
+        this->args.add_argument("--lns")
+            .help("improve the heuristic tours by solving the exact model over windows of vertices")
+            .default_value(false)
+            .implicit_value(true);
+
+        this->args.add_argument("--lns-rounds")
+            .help("number of windows solved by the large neighborhood search")
+            .default_value<unsigned>(50)
+            .scan<'u', unsigned>();
+
+        this->args.add_argument("--lns-window")
+            .help("number of vertices freed in each window")
+            .default_value<unsigned>(30)
+            .scan<'u', unsigned>();
+
+        this->args.add_argument("--lns-time")
+            .help("time limit for each window (in seconds)")
+            .default_value<double>(2.0)
+            .scan<'g', double>();
+
+        this->args.add_argument("--benders")
+            .help("decompose over the shared edges, solving each tour separately with them fixed")
+            .default_value(false)
+            .implicit_value(true);
+
+        this->args.add_argument("--benders-iterations")
+            .help("maximum number of master problems solved by the decomposition")
+            .default_value<unsigned>(100)
+            .scan<'u', unsigned>();
+
+        this->args.add_argument("--threads")
+            .help("threads used by the solver, all cores if zero")
+            .default_value<unsigned>(0)
+            .scan<'u', unsigned>();
+
+        this->args.add_argument("--concurrent")
+            .help("independent MIP solves run concurrently, each with its share of the threads")
+            .default_value<unsigned>(1)
+            .scan<'u', unsigned>();
+
+        this->args.add_argument("--progress-log")
+            .help("write the incumbent and bound timeline of the exact model to this JSON Lines file");
+
+        this->args.add_argument("--progress-interval")
+            .help("minimum solver time between progress events in the log (in seconds)")
+            .default_value<double>(1.0)
+            .scan<'g', double>();
+
+        this->args.add_argument("--checkpoint")
+            .help("periodically save the incumbent and the subtour cuts of the exact model to this file");
+
+        this->args.add_argument("--checkpoint-interval")
+            .help("minimum solver time between checkpoints (in seconds)")
+            .default_value<double>(300.0)
+            .scan<'g', double>();
+
+        this->args.add_argument("--resume")
+            .help("rebuild the exact model with the cuts and incumbent of a checkpoint, saving back to it");
+
+        this->args.add_argument("--deterministic")
+            .help("limit the exact model by deterministic work units instead of wall time, so reruns repeat exactly")
+            .default_value(false)
+            .implicit_value(true);
+#endif
+    }
+
+    /** `convert IN OUT [options]` is short for `--instance IN --convert OUT [options]`, every vertex unless `-n` says otherwise. */
+    [[gnu::cold]]
+    static std::vector<std::string> expand(std::vector<std::string> arguments) {
+        if (arguments.size() < 4 || arguments[1] != "convert") [[likely]] {
+            return arguments;
+        }
+        const auto input = arguments[2], output = arguments[3];
+        arguments.erase(arguments.begin() + 1, arguments.begin() + 4);
+        arguments.insert(arguments.begin() + 1, { "--instance", input, "--convert", output });
+
+        const bool sized = std::any_of(arguments.begin(), arguments.end(), [](const std::string& arg) {
+            return arg == "-n" || arg == "--nodes";
+        });
+        if (!sized) [[likely]] {
+            arguments.insert(arguments.end(), { "-n", "0" });
+        }
+        return arguments;
     }
 
 public:
     [[gnu::cold]]
     explicit program(const std::vector<std::string>& arguments): program(arguments[0]) {
         try {
-            this->args.parse_args(arguments);
+            this->args.parse_args(expand(arguments));
 
         } catch (const std::runtime_error& err) {
             std::cerr << err.what() << std::endl;
             std::cerr << this->args << std::endl;
             std::exit(EXIT_FAILURE);
         }
+
+        if (const auto spec = this->args.present<std::string>("generate")) [[unlikely]] {
+            try {
+                this->data = instance(generator::from(*spec).generate());
+            } catch (const std::invalid_argument& err) {
+                std::cerr << err.what() << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+        } else if (const auto path = this->args.present<std::string>("instance")) [[unlikely]] {
+            try {
+                const auto second = this->args.present<std::string>("second-space");
+                if (second) [[unlikely]] {
+                    this->data = tsplib::load(*path, *second);
+                } else if (binary_instance::matches(*path)) {
+                    this->mapped = std::make_shared<const binary_instance>(*path);
+                    this->data = instance(this->mapped, this->mapped->ids(), this->mapped->columns(), this->mapped->metric());
+                } else if (tsplib::matches(*path)) {
+                    this->data = tsplib::load(*path);
+                } else {
+                    this->data = instance::load(*path);
+                }
+            } catch (const utils::invalid_file& err) {
+                std::cerr << err.what() << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+        }
+        if (const auto name = this->args.present<std::string>("metric")) [[unlikely]] {
+            this->data = this->data.with_metric(*metric::named(*name));
+        }
+
+#ifndef HEURISTIC_ONLY
+        if (!this->heuristic()) [[likely]] {
+            this->env = utils::quiet_env(this->threads(), this->concurrent(), this->seed());
+        }
+#endif
     }
 
-    const GRBEnv env = utils::quiet_env();
+#ifndef HEURISTIC_ONLY
+    /** Only started for the exact model, so the heuristic runs without a license. */
+    std::optional<GRBEnv> env;
+#endif
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    /** Every vertex available, the embedded ones unless `--instance` or `--generate` replace them. */
+    instance data = instance::embedded();
+    /** Binary `--instance`, owning the vertices of `data` and their stored candidate lists. */
+    std::shared_ptr<const binary_instance> mapped;
 
     [[gnu::pure]] [[gnu::cold]]
     inline unsigned nodes() const {
+        if (this->args.present<std::string>("generate")) [[unlikely]] {
+            return this->data.size();
+        }
         return this->args.get<unsigned>("nodes");
     }
 
@@ -75,6 +331,21 @@ public:
         return this->args.get<unsigned>("similarity");
     }
 
+#ifndef HEURISTIC_ONLY
+    [[gnu::pure]] [[gnu::cold]]
+    inline unsigned tour_count() const {
+        return this->args.get<unsigned>("tours");
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline utils::sharing sharing() const {
+        if (this->args.get<std::string>("sharing") == "common") [[unlikely]] {
+            return utils::sharing::common;
+        }
+        return utils::sharing::pairwise;
+    }
+#endif
+
     [[gnu::pure]] [[gnu::cold]]
     inline std::optional<double> timeout() const {
         auto value = this->args.get<double>("timeout");
@@ -85,90 +356,568 @@ public:
         }
     }
 
+    /** Seconds left of the `--timeout`, counting everything run so far. */
+    [[gnu::pure]] [[gnu::cold]]
+    inline std::optional<double> remaining() const {
+        const auto minutes = this->timeout();
+        if (!minutes) [[unlikely]] {
+            return std::nullopt;
+        }
+        const std::chrono::duration<double> secs = std::chrono::steady_clock::now() - this->start;
+        return std::max(0.0, 60.0 * *minutes - secs.count());
+    }
+
     [[gnu::pure]] [[gnu::cold]]
     inline bool tour() const {
         return this->args.get<bool>("tour");
     }
 
+    /** Always set when built without Gurobi. */
+    [[gnu::pure]] [[gnu::cold]]
+    inline bool heuristic() const {
+#ifdef HEURISTIC_ONLY
+        return true;
+#else
+        return this->args.get<bool>("heuristic");
+#endif
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline bool bound() const {
+        return this->args.get<bool>("bound");
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline utils::candidate_set candidates() const {
+        if (this->args.get<std::string>("candidates") == "alpha") {
+            return utils::candidate_set::alpha;
+        }
+        return utils::candidate_set::nearest;
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline unsigned candidate_width() const {
+        return this->args.get<unsigned>("candidate-width");
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline bool coverage() const {
+        return this->args.get<bool>("coverage");
+    }
+
+#ifndef HEURISTIC_ONLY
+    [[gnu::pure]] [[gnu::cold]]
+    inline bool sparse() const {
+        return this->args.get<bool>("sparse");
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline bool eliminate() const {
+        return this->args.get<bool>("eliminate");
+    }
+#endif
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline unsigned kicks() const {
+        return this->args.get<unsigned>("kicks");
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline unsigned depth() const {
+        return this->args.get<unsigned>("depth");
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline unsigned seed() const {
+        return this->args.get<unsigned>("seed");
+    }
+
+#ifndef HEURISTIC_ONLY
+    [[gnu::pure]] [[gnu::cold]]
+    inline bool mip_start() const {
+        return this->args.get<bool>("mip-start");
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline bool large_neighborhood() const {
+        return this->args.get<bool>("lns");
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline bool decomposition() const {
+        return this->args.get<bool>("benders");
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline unsigned threads() const {
+        return this->args.get<unsigned>("threads");
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline unsigned concurrent() const {
+        return this->args.get<unsigned>("concurrent");
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline bool deterministic() const {
+        return this->args.get<bool>("deterministic");
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline std::optional<std::string> progress_path() const {
+        return this->args.present<std::string>("progress-log");
+    }
+#endif
+
 private:
+    /** The instance in use, the first `-n` vertices of `data` or every one if zero. */
+    [[gnu::cold]]
+    inline instance problem() const {
+        return this->nodes() > 0 ? this->data.first(this->nodes()) : this->data;
+    }
+
     [[gnu::cold]]
     inline std::span<const vertex> vertices() const {
-        if (this->nodes() > DEFAULT_VERTICES.size()) [[unlikely]] {
-            throw utils::not_enough_items::in(DEFAULT_VERTICES, this->nodes());
+        return this->problem().vertices();
+    }
+
+#ifndef HEURISTIC_ONLY
+    /** Full model of `M` tours, or reduced by `--sparse` and, for a pair, by the edges `incumbent` eliminates. */
+    template <typename Metric, size_t M = 2>
+    [[gnu::cold]]
+    graph<Metric, M> map(const std::optional<utils::pair<::tour>>& incumbent = std::nullopt) const {
+        if (!this->sparse() && !incumbent) [[likely]] {
+            return graph<Metric, M>(this->problem(), *this->env, this->similarity(), std::nullopt, this->sharing());
         }
-        return std::span(DEFAULT_VERTICES).first(this->nodes());
+        return graph<Metric, M>(this->problem(), *this->env, this->similarity(), this->reduction<Metric, M>(incumbent), this->sharing());
     }
 
+    /** Edges between candidates of either end if `--sparse`, minus the ones eliminated, nothing forced. */
+    template <typename Metric, size_t M = 2>
     [[gnu::cold]]
-    graph map() const {
-        return graph(this->vertices(), this->env, this->similarity());
+    utils::basic_edge_filter<M> reduction(const std::optional<utils::pair<::tour>>& incumbent) const {
+        const auto vertices = this->vertices();
+        const size_t n = vertices.size();
+        auto filter = utils::basic_edge_filter<M>::every(n);
+
+        if (this->sparse()) {
+            // tours in the same space share its candidates
+            auto near = std::array<std::optional<neighbors>, vertex::spaces>();
+            for (uint8_t i = 0; i < M; i++) {
+                auto& space = near[vertex::space_of(i)];
+                if (!space) [[likely]] {
+                    space.emplace(held_karp<Metric>::candidates(vertices, vertex::space_of(i), this->candidates(), this->candidate_width()));
+                }
+                for (unsigned u = 0; u < n; u++) {
+                    for (unsigned v = 0; v < n; v++) {
+                        filter.allowed[i][u][v] = filter.allowed[i][u][v] && space->contains(u, v);
+                    }
+                }
+            }
+        }
+
+        if constexpr (M != 2) {
+            return filter;
+        }
+        if (incumbent) {
+            const auto pruned = pruning::eliminate<Metric>(vertices, *incumbent);
+            std::cout << "Edge elimination: " << pruned.removed[0] << " + " << pruned.removed[1] << " variables, "
+                << pruned.nonzeros() << " nonzeros, " << pruned.shared_removed << " similarity terms removed in "
+                << pruned.elapsed << " secs" << std::endl;
+
+            for (uint8_t i = 0; i <= 1; i++) {
+                for (unsigned u = 0; u < n; u++) {
+                    for (unsigned v = 0; v < n; v++) {
+                        filter.allowed[i][u][v] = filter.allowed[i][u][v] && pruned.viable[i][u][v];
+                    }
+                }
+            }
+        }
+        return filter;
     }
+#endif
 
-public:
+    /** Candidate lists stored in a binary `--instance`, when they cover the vertices in use. */
+    [[gnu::cold]]
+    std::optional<utils::pair<neighbors>> stored_candidates() const {
+        if (!this->mapped || this->mapped->metric() != this->data.metric()) [[likely]] {
+            return std::nullopt;
+        }
+        const size_t n = this->problem().size();
+        auto first = this->mapped->candidates(0, n), second = this->mapped->candidates(1, n);
+        if (!first || !second) {
+            return std::nullopt;
+        }
+        return utils::pair<neighbors> { std::move(*first), std::move(*second) };
+    }
+
+    template <typename Metric>
+    [[gnu::cold]]
+    ::heuristic<Metric> search() const {
+        auto stored = this->stored_candidates();
+        auto h = stored
+            ? ::heuristic<Metric>(this->problem(), std::move(*stored), this->similarity(), this->kicks(), this->depth(), this->seed())
+            : ::heuristic<Metric>(this->problem(), this->similarity(), this->kicks(), this->depth(),
+                this->candidates(), this->candidate_width(), this->seed());
+        if (const auto secs = this->remaining()) [[likely]] {
+            h.time_limit(*secs);
+        }
+        return h;
+    }
+
+#ifndef HEURISTIC_ONLY
+    /** Heuristic pair used as the MIP start, by the edge elimination and as the incumbent of the other methods. */
+    template <typename Metric>
+    [[gnu::cold]]
+    utils::pair<::tour> initial_pair() const {
+        auto h = this->search<Metric>();
+        const double elapsed = h.solve();
+        std::cout << "Initial pair: cost " << h.solution_cost() << ", similarity " << h.similarity()
+            << " in " << elapsed << " secs" << std::endl;
+        return h.tours();
+    }
+
+    template <typename Metric>
+    [[gnu::cold]]
+    ::lns<Metric> improve() const {
+        return ::lns<Metric>(
+            this->problem(), *this->env, this->similarity(), this->initial_pair<Metric>(),
+            this->args.get<unsigned>("lns-rounds"),
+            this->args.get<unsigned>("lns-window"),
+            this->args.get<double>("lns-time"),
+            this->seed()
+        );
+    }
+
+    template <typename Metric>
+    [[gnu::cold]]
+    ::benders<Metric> decompose() const {
+        return ::benders<Metric>(
+            this->problem(), *this->env, utils::quiet_env(this->threads(), this->concurrent(), this->seed()),
+            this->similarity(), this->initial_pair<Metric>(),
+            this->args.get<unsigned>("benders-iterations")
+        );
+    }
+#endif
+
+#ifndef HEURISTIC_ONLY
+    /**
+     * Restores `g` from `--resume`, if given, and starts saving checkpoints to `--checkpoint`,
+     * or back to the resumed file. The saved cuts carry over into the new checkpoints.
+     */
+    template <typename Metric>
+    [[gnu::cold]]
+    std::optional<checkpointer> checkpoints(graph<Metric>& g) const {
+        const auto resume = this->args.present<std::string>("resume");
+        auto state = checkpoint { this->nodes(), this->similarity() };
+        state.metric = Metric::name;
+        state.sharing = this->args.get<std::string>("sharing");
+        state.spaces = { g.spaces[0], g.spaces[1] };
+        state.coordinates = checkpoint::hash(g.vertices);
+        state.edges = g.fingerprint();
+        if (resume) [[unlikely]] {
+            auto saved = checkpoint::load(*resume);
+            if (saved.n != state.n || saved.k != state.k) [[unlikely]] {
+                throw utils::invalid_checkpoint::mismatch(*resume, saved.n, saved.k);
+            }
+            if (const auto what = saved.differs(state)) [[unlikely]] {
+                throw utils::invalid_checkpoint::mismatch(*resume, *what);
+            }
+            state = std::move(saved);
+            g.restore(state);
+            std::cout << "Resumed: " << state.cuts.size() << " cuts";
+            if (state.incumbent) [[likely]] {
+                std::cout << ", incumbent cost " << state.cost;
+            }
+            std::cout << std::endl;
+        }
+
+        const auto path = this->args.present<std::string>("checkpoint");
+        if (!path && !resume) [[likely]] {
+            return std::nullopt;
+        }
+        return checkpointer(path ? *path : *resume, this->args.get<double>("checkpoint-interval"), std::move(state));
+    }
+#endif
+
+    /** Sum of the Held-Karp bounds of `m` tours, each in its space, valid for any `k`. */
+    template <typename Metric>
+    [[gnu::cold]]
+    double lower_bound(size_t m = 2) const {
+        const auto start = std::chrono::steady_clock::now();
+        const auto data = this->problem();
+        auto bounds = std::array<double, vertex::spaces>();
+        for (uint8_t i = 0; i < vertex::spaces; i++) {
+            auto hk = held_karp<Metric>(data.space(i));
+            hk.optimize();
+            bounds[i] = hk.lower_bound();
+        }
+
+        double total = 0.0;
+        std::cout << "Held-Karp bound: ";
+        for (uint8_t i = 0; i < m; i++) {
+            total += bounds[vertex::space_of(i)];
+            std::cout << (i > 0 ? " + " : "") << bounds[vertex::space_of(i)];
+        }
+        const std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+        std::cout << " = " << total << " in " << secs.count() << " secs" << std::endl;
+        return total;
+    }
+
+    /** Summary shared by the exact model and the heuristics. */
+    template <typename Metric>
     [[gnu::hot]]
-    void run() const {
-        auto g = this->map();
+    void report(auto& g, std::optional<double> start_cost = std::nullopt) const {
         std::cout << "Graph(n=" << g.order() << ",m=" << g.size() << ")" << std::endl;
-
+        std::cout << "Metric: " << Metric::name << std::endl;
+        constexpr size_t m = std::tuple_size_v<std::remove_cvref_t<decltype(g.tours())>>;
+        const auto bound = this->bound() ? std::make_optional(this->lower_bound<Metric>(m)) : std::nullopt;
+
+        if (const auto secs = this->remaining()) [[likely]] {
+#ifndef HEURISTIC_ONLY
+            if constexpr (requires { g.work_limit(*secs); }) {
+                if (this->deterministic()) [[unlikely]] {
+                    g.work_limit(*secs);
+                } else {
+                    g.time_limit(*secs);
+                }
+            } else {
+                g.time_limit(*secs);
+            }
+#else
+            g.time_limit(*secs);
+#endif
+        }
         const auto elapsed = g.solve();
+        std::cout << "Status: " << g.status() << std::endl;
         std::cout << "Found " << g.solution_count() << " solution(s)."  << std::endl;
         std::cout << "Iterations: " << g.iterations() << std::endl;
         std::cout << "Execution time: " << elapsed << " secs" << std::endl;
-        std::cout << "Variables: " << g.var_count() << std::endl;
-        std::cout << "Constraints: " << g.constr_count() << std::endl;
-        std::cout << "    Linear: " << g.lin_constr_count() << std::endl;
-        std::cout << "    Quadratic: " << g.quad_constr_count() << std::endl;
+#ifndef HEURISTIC_ONLY
+        if constexpr (requires { g.work(); }) {
+            std::cout << "Work: " << g.work() << " units" << std::endl;
+            this->report_settings();
+        }
+#endif
+        if constexpr (requires { g.var_count(); }) {
+            std::cout << "Variables: " << g.var_count() << std::endl;
+            std::cout << "Constraints: " << g.constr_count() << std::endl;
+            std::cout << "    Linear: " << g.lin_constr_count() << std::endl;
+            std::cout << "    Quadratic: " << g.quad_constr_count() << std::endl;
+        }
         std::cout << "Similarity: " << g.similarity() << std::endl;
         std::cout << "Objective cost: " << g.solution_cost() << std::endl;
+        if constexpr (requires { g.lower_bound(); }) {
+            const double gap = (g.solution_cost() - g.lower_bound()) / std::max(1e-9, g.solution_cost());
+            std::cout << "Lower bound: " << g.lower_bound() << std::endl;
+            std::cout << "    Gap: " << 100.0 * gap << "%" << std::endl;
+        }
+        if constexpr (requires { g.cut_count(); }) {
+            const auto [optimality, feasibility] = g.cut_count();
+            std::cout << "Benders cuts: " << optimality << " optimality, " << feasibility << " feasibility" << std::endl;
+        }
+        if (bound) [[unlikely]] {
+            const double gap = (g.solution_cost() - *bound) / std::max(1e-9, g.solution_cost());
+            std::cout << "    Held-Karp gap: " << 100.0 * gap << "%" << std::endl;
+        }
+        if (start_cost) [[unlikely]] {
+            const double gap = (*start_cost - g.solution_cost()) / std::max(1e-9, g.solution_cost());
+            std::cout << "    MIP start gap: " << 100.0 * gap << "%" << std::endl;
+        }
+        if constexpr (requires { g.polishing; }) {
+            this->report_callback(g);
+        }
+        if constexpr (requires { g.accepted_count(); }) {
+            std::cout << "Accepted kicks: " << g.accepted_count() << std::endl;
+            std::cout << "Move evaluations: " << g.evaluation_count() << std::endl;
+        }
+
+        if (this->coverage()) [[unlikely]] {
+            this->report_coverage<Metric>(g.tours());
+        }
 
-        for (uint8_t i = 0; i <= 1; i++) {
+        // costed over the columns, so the vertices are only built to print the tours
+        const auto data = this->problem();
+        const auto& tours = g.tours();
+        const auto prefix = this->args.present<std::string>("tour-files");
+        for (uint8_t i = 0; i < m; i++) {
+            std::cout << "Tour " << i+1 << ": total cost " << tours[i].template cost<Metric>(data.space(vertex::space_of(i))) << std::endl;
+            if (!this->tour() && !prefix) [[likely]] {
+                continue;
+            }
             const auto solution = g.solution(i);
-            std::cout << "Tour " << i+1 << ": total cost " << tour::cost(i, solution) << std::endl;
             if (this->tour()) [[unlikely]] {
                 std::cout << utils::join(solution, "\n") << std::endl;
             }
+            if (prefix) [[unlikely]] {
+                const auto name = *prefix + "." + std::to_string(i + 1) + ".tour";
+                tsplib::write_tour(name, std::filesystem::path(name).filename().string(), solution);
+            }
+        }
+    }
+
+    template <typename Metric>
+    [[gnu::cold]]
+    void report_coverage(std::span<const ::tour> tours) const {
+        const auto data = this->problem();
+        const unsigned width = this->candidate_width();
+
+        std::cout << "Candidate coverage (width " << width << "):" << std::endl;
+        for (uint8_t i = 0; i < tours.size(); i++) {
+            const auto nearest = held_karp<Metric>::candidates(data.space(vertex::space_of(i)), utils::candidate_set::nearest, width);
+            const auto alpha = held_karp<Metric>::candidates(data.space(vertex::space_of(i)), utils::candidate_set::alpha, width);
+            std::cout << "    Tour " << i+1 << ": " << nearest.covers(tours[i]) << "/" << tours[i].size() << " nearest, "
+                << alpha.covers(tours[i]) << "/" << tours[i].size() << " alpha" << std::endl;
         }
     }
-};
 
-namespace timeout {
-    static auto start = std::chrono::steady_clock::now();
+#ifndef HEURISTIC_ONLY
+    /** Solver configuration, to compare runs by throughput per core. */
+    [[gnu::cold]]
+    void report_settings() const {
+        std::cout << "Threads: ";
+        if (this->threads() > 0) [[unlikely]] {
+            std::cout << this->threads();
+        } else {
+            std::cout << "all (" << std::thread::hardware_concurrency() << ")";
+        }
+        std::cout << std::endl;
+        std::cout << "    Concurrent MIP: " << this->concurrent() << std::endl;
+        std::cout << "    Seed: " << this->seed() << std::endl;
+        std::cout << "    Limit: " << (this->deterministic() ? "deterministic work" : "opportunistic wall time") << std::endl;
+    }
+#endif
 
-    [[gnu::cold]] [[gnu::nothrow]]
-    static void on_timeout(int signal) noexcept {
-        if (signal == SIGALRM) [[likely]] {
-            const auto end = std::chrono::steady_clock::now();
-            std::chrono::duration<double, std::ratio<60>> elapsed = end - start;
+    [[gnu::cold]]
+    void report_callback(const auto& g) const {
+        std::cout << "Polishing: " << g.polishing.improved << "/" << g.polishing.attempts << " incumbent(s) improved, "
+            << g.polishing.injected << " injected" << std::endl;
+        std::cout << "    Total gain: " << g.polishing.total_gain << std::endl;
+        std::cout << "    Best gain: " << g.polishing.best_gain << std::endl;
+        std::cout << "Patching: " << g.patching.rejected << " rejected solution(s) repaired, "
+            << g.patching.restored << " restored to k-similar, " << g.patching.injected << " injected" << std::endl;
+    }
 
-            std::cerr << "Timeout: stopping execution for taking too long." << std::endl;
-            std::cerr << "Instance has been running for " << elapsed.count() << " minutes." << std::endl;
-            std::exit(EXIT_FAILURE);
+    /** Writes the vertices in use to a binary instance at `path`, with their metric and candidate lists. */
+    template <typename Metric>
+    [[gnu::cold]]
+    void convert(const std::string& path) const {
+        const auto data = this->problem();
+        const unsigned width = this->candidate_width();
+        if (width == 0 || data.size() < 2) [[unlikely]] {
+            binary_instance::write(path, data);
+        } else {
+            const auto near = utils::pair<neighbors> {
+                held_karp<Metric>::candidates(data.space(0), this->candidates(), width),
+                held_karp<Metric>::candidates(data.space(1), this->candidates(), width),
+            };
+            binary_instance::write(path, data, &near);
         }
+        std::cout << "Converted: " << data.size() << " vertices to " << path << std::endl;
     }
 
-    [[gnu::cold]] [[gnu::nothrow]]
-    static void setup(double minutes) {
+#ifndef HEURISTIC_ONLY
+    /**
+     * The exact model of `M` tours. Only pairs start from, or are reduced by, the initial pair,
+     * and only pairs are checkpointed, since the heuristics and the saved incumbents are pairs.
+     */
+    template <typename Metric, size_t M>
+    [[gnu::cold]]
+    void exact() const {
+        if constexpr (M != 2) {
+            if (this->mip_start() || this->eliminate() || this->args.present<std::string>("checkpoint") || this->args.present<std::string>("resume")) [[unlikely]] {
+                throw std::runtime_error("--tours: '--mip-start', '--eliminate', '--checkpoint' and '--resume' need a pair of tours");
+            }
+            auto g = this->map<Metric, M>();
+            auto log = std::optional<progress_log>();
+            if (const auto path = this->progress_path()) [[unlikely]] {
+                log.emplace(*path, this->args.get<double>("progress-interval"));
+                g.log_progress(*log);
+            }
+            this->report<Metric>(g);
+        } else {
+            const auto start = (this->mip_start() || this->eliminate()) ? std::make_optional(this->initial_pair<Metric>()) : std::nullopt;
+            auto g = this->map<Metric>(this->eliminate() ? start : std::nullopt);
+            auto log = std::optional<progress_log>();
+            if (const auto path = this->progress_path()) [[unlikely]] {
+                log.emplace(*path, this->args.get<double>("progress-interval"));
+                g.log_progress(*log);
+            }
+            if (this->mip_start()) [[unlikely]] {
+                g.warm_start(*start);
+            }
+            auto saving = this->checkpoints(g);
+            if (saving) [[unlikely]] {
+                g.save_progress(*saving);
+            }
+
+            if (this->mip_start()) [[unlikely]] {
+                const auto vertices = this->vertices();
+                this->report<Metric>(g, (*start)[0].template cost<Metric>(0, vertices) + (*start)[1].template cost<Metric>(1, vertices));
+            } else {
+                this->report<Metric>(g);
+            }
+        }
+    }
+#endif
 
-        if (std::signal(SIGALRM, on_timeout) == SIG_ERR) [[unlikely]] {
-            std::cerr << "Warning: could not setup timeout for " << minutes << " minutes." << std::endl;
+    /** Everything `run` does, with the edge costs of `Metric` compiled into every model and search. */
+    template <typename Metric>
+    [[gnu::hot]]
+    void run() const {
+        if (const auto path = this->args.present<std::string>("convert")) [[unlikely]] {
+            this->convert<Metric>(*path);
             return;
         }
+#ifndef HEURISTIC_ONLY
+        if (this->tour_count() != 2 && (this->heuristic() || this->large_neighborhood() || this->decomposition())) [[unlikely]] {
+            throw std::runtime_error("--tours: only the exact model builds more than two tours");
+        }
+        if (!this->heuristic() && this->large_neighborhood()) [[unlikely]] {
+            auto l = this->improve<Metric>();
+            this->report<Metric>(l);
+            return;
+        }
+        if (!this->heuristic() && this->decomposition()) [[unlikely]] {
+            auto b = this->decompose<Metric>();
+            this->report<Metric>(b);
+            return;
+        }
+        if (!this->heuristic()) [[likely]] {
+            switch (this->tour_count()) {
+                case 2:
+                    return this->exact<Metric, 2>();
+                case 3:
+                    return this->exact<Metric, 3>();
+                case 4:
+                    return this->exact<Metric, 4>();
+                default:
+                    throw std::runtime_error("--tours: expected 2 to 4, got " + std::to_string(this->tour_count()));
+            }
+        }
+#endif
+        auto h = this->search<Metric>();
+        this->report<Metric>(h);
+    }
 
-        alarm((unsigned) std::ceil(minutes * 60));
+public:
+    /** Picks the metric of the instance, the only place it is not known at compile time. */
+    [[gnu::hot]]
+    void run() const {
+        metric::dispatch(this->data.metric(), [this](auto policy) {
+            this->run<decltype(policy)>();
+        });
     }
-}
+};
 
 
 int main(int argc, const char * const argv[]) {
     const program program(std::vector<std::string>(argv, argv + argc));
 
-    if (auto minutes = program.timeout()) [[likely]] {
-        timeout::setup(*minutes);
-    }
-
     try {
         program.run();
 
+#ifndef HEURISTIC_ONLY
     } catch (const utils::invalid_solution& err) {
         std::cerr << "utils::invalid_solution: " << err.what() << std::endl;
         if (err.subtour) {
@@ -178,13 +927,16 @@ int main(int argc, const char * const argv[]) {
         std::cerr << "vertices:" << std::endl;
         std::cerr << utils::join(err.vertices, "\n") << std::endl;
 
-    } catch (const std::exception& err) {
-        std::cerr << "std::exception: " << err.what() << std::endl;
-        return EXIT_FAILURE;
-
     } catch (const GRBException& err) {
         std::cerr << "GRBException: code " << err.getErrorCode() << ", " << err.getMessage() << std::endl;
-        std::cerr << "GRBEnv::getErrorMsg: " << program.env.getErrorMsg() << std::endl;
+        if (program.env) {
+            std::cerr << "GRBEnv::getErrorMsg: " << program.env->getErrorMsg() << std::endl;
+        }
+        return EXIT_FAILURE;
+#endif
+
+    } catch (const std::exception& err) {
+        std::cerr << "std::exception: " << err.what() << std::endl;
         return EXIT_FAILURE;
 
     } catch (...) {
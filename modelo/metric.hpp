@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+
+/**
+ * Edge cost policies, one per TSPLIB `EDGE_WEIGHT_TYPE`. Every model and search is a template
+ * over one of them, so each metric gets its own inlined kernel, picked once by `dispatch`.
+ * `cost` is the integral cost of an edge between two points, and `key` is anything monotone
+ * in it, cheaper to compute, for ranking neighbors.
+ */
+namespace metric {
+    /** Euclidean distance rounded up, the metric of the embedded instance. */
+    struct ceil_2d final {
+        static constexpr std::string_view name = "CEIL_2D";
+
+        [[gnu::const]] [[gnu::hot]] [[gnu::nothrow]]
+        static constexpr inline double cost(double x1, double y1, double x2, double y2) noexcept {
+            const double dx = x1 - x2, dy = y1 - y2;
+            return std::ceil(std::sqrt(dx * dx + dy * dy));
+        }
+
+        [[gnu::const]] [[gnu::hot]] [[gnu::nothrow]]
+        static constexpr inline double key(double x1, double y1, double x2, double y2) noexcept {
+            const double dx = x1 - x2, dy = y1 - y2;
+            return dx * dx + dy * dy;
+        }
+    };
+
+    /** Euclidean distance rounded to the nearest integer. */
+    struct euc_2d final {
+        static constexpr std::string_view name = "EUC_2D";
+
+        [[gnu::const]] [[gnu::hot]] [[gnu::nothrow]]
+        static constexpr inline double cost(double x1, double y1, double x2, double y2) noexcept {
+            const double dx = x1 - x2, dy = y1 - y2;
+            return std::floor(std::sqrt(dx * dx + dy * dy) + 0.5);
+        }
+
+        [[gnu::const]] [[gnu::hot]] [[gnu::nothrow]]
+        static constexpr inline double key(double x1, double y1, double x2, double y2) noexcept {
+            return ceil_2d::key(x1, y1, x2, y2);
+        }
+    };
+
+    /** Pseudo-Euclidean distance of the `att` instances, rounded up unless exact. */
+    struct att final {
+        static constexpr std::string_view name = "ATT";
+
+        [[gnu::const]] [[gnu::hot]] [[gnu::nothrow]]
+        static constexpr inline double cost(double x1, double y1, double x2, double y2) noexcept {
+            const double dx = x1 - x2, dy = y1 - y2;
+            const double r = std::sqrt((dx * dx + dy * dy) / 10.0);
+            const double t = std::floor(r + 0.5);
+            return t < r ? t + 1.0 : t;
+        }
+
+        [[gnu::const]] [[gnu::hot]] [[gnu::nothrow]]
+        static constexpr inline double key(double x1, double y1, double x2, double y2) noexcept {
+            return ceil_2d::key(x1, y1, x2, y2);
+        }
+    };
+
+    /** Great circle distance in km, with coordinates as `DDD.MM` latitude and longitude. */
+    struct geo final {
+        static constexpr std::string_view name = "GEO";
+
+        [[gnu::const]] [[gnu::hot]] [[gnu::nothrow]]
+        static constexpr inline double radians(double coord) noexcept {
+            const double degrees = std::trunc(coord);
+            return 3.141592 * (degrees + 5.0 * (coord - degrees) / 3.0) / 180.0;
+        }
+
+        [[gnu::const]] [[gnu::hot]] [[gnu::nothrow]]
+        static constexpr inline double cost(double x1, double y1, double x2, double y2) noexcept {
+            const double lat1 = radians(x1), lon1 = radians(y1), lat2 = radians(x2), lon2 = radians(y2);
+            const double q1 = std::cos(lon1 - lon2), q2 = std::cos(lat1 - lat2), q3 = std::cos(lat1 + lat2);
+            return std::trunc(6378.388 * std::acos(0.5 * ((1.0 + q1) * q2 - (1.0 - q1) * q3)) + 1.0);
+        }
+
+        [[gnu::const]] [[gnu::hot]] [[gnu::nothrow]]
+        static constexpr inline double key(double x1, double y1, double x2, double y2) noexcept {
+            return cost(x1, y1, x2, y2);
+        }
+    };
+
+    /** The policies, as a value chosen at runtime. */
+    enum class kind : uint8_t {
+        ceil_2d,
+        euc_2d,
+        att,
+        geo,
+    };
+
+    /** The metric of a TSPLIB `EDGE_WEIGHT_TYPE`, if supported. */
+    [[gnu::pure]] [[gnu::cold]]
+    constexpr inline std::optional<kind> named(std::string_view name) noexcept {
+        if (name == ceil_2d::name) {
+            return kind::ceil_2d;
+        } else if (name == euc_2d::name) {
+            return kind::euc_2d;
+        } else if (name == att::name) {
+            return kind::att;
+        } else if (name == geo::name) {
+            return kind::geo;
+        }
+        return std::nullopt;
+    }
+
+    /** Calls `run` with a value of the policy of `metric`, the only runtime branch on it. */
+    template <typename Run>
+    [[gnu::cold]]
+    constexpr inline decltype(auto) dispatch(kind metric, Run&& run) {
+        switch (metric) {
+            case kind::euc_2d:
+                return run(euc_2d {});
+            case kind::att:
+                return run(att {});
+            case kind::geo:
+                return run(geo {});
+            default:
+                return run(ceil_2d {});
+        }
+    }
+}
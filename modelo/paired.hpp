@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "vertex.hpp"
+#include "tour.hpp"
+#include "local_search.hpp"
+
+
+/**
+ * Candidate list descent over a pair of tours that must share at least `k` edges. Each
+ * tour is optimized in turn against the edges of the other, which stay fixed meanwhile, so
+ * the shared count of every move is known in O(1) from the positions in the other tour.
+ */
+template <typename Metric>
+struct paired_search final {
+private:
+    const utils::columns& coords;
+    const utils::pair<neighbors>& near;
+    const unsigned k;
+    const unsigned depth;
+    const utils::deadline stop;
+
+    utils::pair<tour> tours;
+    unsigned shared;
+    uint64_t evaluated = 0;
+
+    [[gnu::hot]]
+    static inline std::vector<unsigned> index(const tour& t) {
+        auto pos = std::vector<unsigned>(t.size());
+        for (unsigned p = 0; p < t.size(); p++) {
+            pos[t[p]] = p;
+        }
+        return pos;
+    }
+
+    /** Optimizes tour `i` from `dirty`, or from every vertex if empty, returning if it changed. */
+    [[gnu::hot]]
+    bool optimize(uint8_t i, std::span<const unsigned> dirty) {
+        const auto pos = index(this->tours[1 - i]);
+        const auto edges = utils::shared_edges { pos, this->k, this->shared };
+
+        auto search = local_search(utils::space_cost<Metric> { this->coords[i] }, this->near[i], this->tours[i], this->depth, edges, this->stop);
+        if (dirty.empty()) {
+            search.activate_all();
+        }
+        for (const unsigned v : dirty) {
+            search.activate(v);
+        }
+
+        search.optimize();
+        this->evaluated += search.evaluations();
+        if (search.improvements() == 0) [[likely]] {
+            return false;
+        }
+
+        this->tours[i] = search.result();
+        this->shared = search.similarity().count;
+        return true;
+    }
+
+public:
+    [[gnu::hot]]
+    paired_search(
+        const utils::columns& coords,
+        const utils::pair<neighbors>& near,
+        unsigned k,
+        const utils::pair<tour>& tours,
+        unsigned depth = utils::lk_depth,
+        utils::deadline stop = utils::deadline()
+    ):
+        coords(coords), near(near), k(k), depth(depth), stop(stop), tours(tours), shared(0)
+    {
+        const auto pos = index(this->tours[1]);
+        const auto edges = utils::shared_edges { pos, this->k, 0 };
+
+        const auto& t = this->tours[0];
+        for (unsigned p = 0; p < t.size(); p++) {
+            this->shared += edges.contains(t[p], t[(p + 1) % t.size()]);
+        }
+    }
+
+    /**
+     * Alternates between the tours until neither improves, or the deadline passes, starting
+     * each round from the vertices in `dirty`, or from every vertex if empty.
+     */
+    [[gnu::hot]]
+    void optimize(std::span<const unsigned> dirty = {}) {
+        bool changed = true;
+        while (changed && !this->stop.passed()) {
+            changed = false;
+            for (uint8_t i = 0; i <= 1; i++) {
+                changed |= this->optimize(i, dirty);
+            }
+        }
+    }
+
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline const utils::pair<tour>& result() const noexcept {
+        return this->tours;
+    }
+
+    /** Edges shared by both tours. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline unsigned similarity() const noexcept {
+        return this->shared;
+    }
+
+    /** Moves whose cost change was computed. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline uint64_t evaluations() const noexcept {
+        return this->evaluated;
+    }
+};
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include "vertex.hpp"
+#include "tour.hpp"
+
+
+namespace utils {
+    /** Counters reported for the repair of integer solutions rejected by the callback. */
+    struct patch_stats final {
+    public:
+        /** Integer solutions rejected for containing subtours. */
+        unsigned rejected = 0;
+        /** Repaired pairs that had to be made k-similar again. */
+        unsigned restored = 0;
+        /** Repaired pairs actually injected into the solver. */
+        unsigned injected = 0;
+    };
+}
+
+
+/**
+ * Karp style patching: merges the cycles of a 2-factor into a single tour by repeatedly
+ * joining the smallest cycle to another one through the cheapest 2-exchange between them.
+ */
+template <typename Metric>
+struct patch final {
+private:
+    const utils::plane space;
+
+    [[gnu::cold]] [[gnu::nothrow]]
+    explicit inline patch(const utils::plane& space) noexcept: space(space) { }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline double cost(unsigned u, unsigned v) const noexcept {
+        return this->space.template cost<Metric>(u, v);
+    }
+
+    struct exchange final {
+        double delta = std::numeric_limits<double>::infinity();
+        unsigned other = 0;
+        unsigned p = 0;
+        unsigned q = 0;
+        bool crossed = false;
+    };
+
+    /** Cheapest way to drop one edge from `small` and one from `other`, then reconnect them. */
+    [[gnu::hot]]
+    inline void cheapest(const tour& small, const tour& other, unsigned idx, exchange& best) const noexcept {
+        for (unsigned p = 0; p < small.size(); p++) {
+            const unsigned a1 = small[p], a2 = small[(p + 1) % small.size()];
+            const double cost_a = this->cost(a1, a2);
+
+            for (unsigned q = 0; q < other.size(); q++) {
+                const unsigned b1 = other[q], b2 = other[(q + 1) % other.size()];
+                const double removed = cost_a + this->cost(b1, b2);
+
+                const double straight = this->cost(a1, b2) + this->cost(a2, b1) - removed;
+                if (straight < best.delta) [[unlikely]] {
+                    best = exchange { straight, idx, p, q, false };
+                }
+                const double crossed = this->cost(a1, b1) + this->cost(a2, b2) - removed;
+                if (crossed < best.delta) [[unlikely]] {
+                    best = exchange { crossed, idx, p, q, true };
+                }
+            }
+        }
+    }
+
+    /** Walks `small` from the end of the dropped edge, then `other` back to the start. */
+    [[gnu::hot]]
+    static inline tour merge(const tour& small, const tour& other, const exchange& ex) {
+        auto merged = tour();
+        merged.reserve(small.size() + other.size());
+
+        for (unsigned s = 1; s <= small.size(); s++) {
+            merged.push_back(small[(ex.p + s) % small.size()]);
+        }
+        for (unsigned s = 1; s <= other.size(); s++) {
+            if (ex.crossed) {
+                merged.push_back(other[(ex.q + other.size() + 1 - s) % other.size()]);
+            } else {
+                merged.push_back(other[(ex.q + s) % other.size()]);
+            }
+        }
+        return merged;
+    }
+
+    [[gnu::hot]]
+    tour join(std::vector<tour> cycles) const {
+        while (cycles.size() > 1) [[likely]] {
+            const auto smallest = std::min_element(cycles.begin(), cycles.end(), [](const tour& a, const tour& b) {
+                return a.size() < b.size();
+            });
+            std::iter_swap(smallest, cycles.end() - 1);
+            const tour small = std::move(cycles.back());
+            cycles.pop_back();
+
+            auto best = exchange();
+            for (unsigned idx = 0; idx < cycles.size(); idx++) {
+                this->cheapest(small, cycles[idx], idx, best);
+            }
+            cycles[best.other] = merge(small, cycles[best.other], best);
+        }
+        return std::move(cycles.front());
+    }
+
+public:
+    /** Single tour over all vertices in `cycles`, patched with the costs of space `i`. */
+    [[gnu::hot]]
+    static tour join(const utils::columns& coords, uint8_t i, std::vector<tour> cycles) {
+        return patch(coords[i]).join(std::move(cycles));
+    }
+
+    /**
+     * If `tours` share less than `k` edges, replaces both by whichever of them is cheaper
+     * in the two spaces, returning if it had to.
+     */
+    [[gnu::hot]]
+    static bool make_similar(const utils::columns& coords, unsigned k, utils::pair<tour>& tours) {
+        if (shared(tours[0], tours[1]) >= k) [[likely]] {
+            return false;
+        }
+        const double first = tours[0].cost<Metric>(coords[0]) + tours[0].cost<Metric>(coords[1]);
+        const double second = tours[1].cost<Metric>(coords[0]) + tours[1].cost<Metric>(coords[1]);
+
+        tours[first <= second ? 1 : 0] = tours[first <= second ? 0 : 1];
+        return true;
+    }
+
+    /** Number of edges present in both `a` and `b`, complete tours over the same vertices. */
+    [[gnu::pure]] [[gnu::hot]]
+    static unsigned shared(const tour& a, const tour& b) {
+        const size_t n = b.size();
+        auto pos = std::vector<unsigned>(n);
+        for (unsigned p = 0; p < n; p++) {
+            pos[b[p]] = p;
+        }
+
+        unsigned total = 0;
+        for (unsigned p = 0; p < a.size(); p++) {
+            const unsigned pu = pos[a[p]], pv = pos[a[(p + 1) % a.size()]];
+            const unsigned diff = pu > pv ? pu - pv : pv - pu;
+            if (diff == 1 || diff == n - 1) {
+                total += 1;
+            }
+        }
+        return total;
+    }
+};
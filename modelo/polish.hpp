@@ -0,0 +1,392 @@
+#pragma once
+
+#include <algorithm>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "vertex.hpp"
+#include "tour.hpp"
+#include "local_search.hpp"
+#include "paired.hpp"
+
+
+namespace utils {
+    /** Counters reported for the incumbent polishing done inside the callback. */
+    struct polish_stats final {
+    public:
+        /** Accepted incumbents handed to the local search. */
+        unsigned attempts = 0;
+        /** Incumbents for which the local search found a cheaper pair. */
+        unsigned improved = 0;
+        /** Improved pairs actually injected into the solver. */
+        unsigned injected = 0;
+        /** Sum of the cost reductions over all improved incumbents. */
+        double total_gain = 0.0;
+        /** Largest single cost reduction. */
+        double best_gain = 0.0;
+
+        [[gnu::hot]] [[gnu::nothrow]]
+        inline void record(double gain) noexcept {
+            this->attempts += 1;
+            if (gain > 0.5) [[unlikely]] {
+                this->improved += 1;
+                this->total_gain += gain;
+                this->best_gain = std::max(this->best_gain, gain);
+            }
+        }
+    };
+}
+
+
+/**
+ * 2-opt and Or-opt descent over a pair of tours, rejecting every move that would leave the
+ * pair with less than `k` shared edges. Shared 2-opt moves, applied to both tours at once,
+ * let the descent keep improving pairs that are forced to be alike. Moves only add edges
+ * to a candidate of one of their endpoints, so a sweep is linear in the tour size. The
+ * pair first goes through the paired descent, so this one only finishes it, and is
+ * skipped entirely when `k` is zero.
+ */
+template <typename Metric>
+struct polish final {
+private:
+    const utils::columns& coords;
+    const utils::pair<neighbors>& near;
+    const unsigned k;
+    const utils::deadline stop;
+
+    utils::pair<tour> tours;
+    utils::pair<std::vector<unsigned>> pos;
+    unsigned shared;
+
+    [[gnu::cold]]
+    inline polish(const utils::columns& coords, const utils::pair<neighbors>& near, unsigned k, const utils::pair<tour>& tours, utils::deadline stop):
+        coords(coords), near(near), k(k), stop(stop), tours(tours), pos({ index(tours[0]), index(tours[1]) }), shared(0)
+    {
+        const auto& t = this->tours[0];
+        for (unsigned p = 0; p < t.size(); p++) {
+            if (this->adjacent(1, t[p], this->at(0, p + 1))) {
+                this->shared += 1;
+            }
+        }
+    }
+
+    [[gnu::hot]]
+    static inline std::vector<unsigned> index(const tour& t) {
+        auto pos = std::vector<unsigned>(t.size());
+        for (unsigned p = 0; p < t.size(); p++) {
+            pos[t[p]] = p;
+        }
+        return pos;
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline size_t count() const noexcept {
+        return this->coords.size();
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline unsigned at(uint8_t i, unsigned p) const noexcept {
+        return this->tours[i][p % this->count()];
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline double cost(uint8_t i, unsigned u, unsigned v) const noexcept {
+        return this->coords[i].cost<Metric>(u, v);
+    }
+
+    /** If `(u, v)` is an edge of tour `i`. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline bool adjacent(uint8_t i, unsigned u, unsigned v) const noexcept {
+        const unsigned pu = this->pos[i][u], pv = this->pos[i][v];
+        const unsigned diff = pu > pv ? pu - pv : pv - pu;
+        return diff == 1 || diff == this->count() - 1;
+    }
+
+    /** Shared edges gained by tour `i` when removing `(a, b)`, `(c, d)` and adding `(a, c)`, `(b, d)`. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline int shared_delta(uint8_t i, unsigned a, unsigned b, unsigned c, unsigned d) const noexcept {
+        const uint8_t o = 1 - i;
+        return int(this->adjacent(o, a, c)) + int(this->adjacent(o, b, d))
+            - int(this->adjacent(o, a, b)) - int(this->adjacent(o, c, d));
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline bool keeps_similarity(int delta) const noexcept {
+        return int(this->shared) + delta >= int(this->k);
+    }
+
+    [[gnu::hot]]
+    inline void reindex(uint8_t i, unsigned from, unsigned to) noexcept {
+        for (unsigned p = from; p <= to; p++) {
+            this->pos[i][this->tours[i][p]] = p;
+        }
+    }
+
+    /**
+     * First improving 2-opt move of tour `i` replacing the edge from `a` to its successor,
+     * or predecessor if not `forward`, by an edge from `a` to one of its candidates.
+     */
+    [[gnu::hot]]
+    bool two_opt(uint8_t i, unsigned a, bool forward) {
+        const unsigned n = this->count();
+        auto& t = this->tours[i];
+        const unsigned p = this->pos[i][a];
+        const unsigned b = this->at(i, forward ? p + 1 : p + n - 1);
+
+        for (const unsigned c : this->near[i][a]) {
+            const unsigned q = this->pos[i][c];
+            const unsigned d = this->at(i, forward ? q + 1 : q + n - 1);
+            if (c == b || d == a) [[unlikely]] {
+                continue;
+            }
+
+            const double delta = this->cost(i, a, c) + this->cost(i, b, d)
+                - this->cost(i, a, b) - this->cost(i, c, d);
+
+            // the path between the two removed edges, which is reversed either way
+            const unsigned from = forward ? std::min(p, q) + 1 : std::min(p, q);
+            const unsigned to = forward ? std::max(p, q) : std::max(p, q) - 1;
+
+            if (delta < -0.5) [[unlikely]] {
+                const int sdelta = this->shared_delta(i, a, b, c, d);
+                if (this->keeps_similarity(sdelta)) [[likely]] {
+                    std::reverse(t.begin() + from, t.begin() + to + 1);
+                    this->reindex(i, from, to);
+                    this->shared += sdelta;
+                    return true;
+                }
+            }
+            if (this->joint_two_opt(i, delta, a, b, c, d)) [[unlikely]] {
+                std::reverse(t.begin() + from, t.begin() + to + 1);
+                this->reindex(i, from, to);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** One sweep of 2-opt moves over every vertex of tour `i`, returning if any was applied. */
+    [[gnu::hot]]
+    bool two_opt(uint8_t i) {
+        bool changed = false;
+        for (unsigned a = 0; a < this->count(); a++) {
+            if (a % 256 == 0 && this->stop.passed()) [[unlikely]] {
+                break;
+            }
+            while (this->two_opt(i, a, true) || this->two_opt(i, a, false)) {
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    /** The one of `u` and `v`, an edge of tour `i`, that comes first along the tour. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline unsigned tail(uint8_t i, unsigned u, unsigned v) const noexcept {
+        return this->at(i, this->pos[i][u] + 1) == v ? u : v;
+    }
+
+    [[gnu::const]] [[gnu::hot]] [[gnu::nothrow]]
+    static inline bool same_edge(unsigned u1, unsigned v1, unsigned u2, unsigned v2) noexcept {
+        return (u1 == u2 && v1 == v2) || (u1 == v2 && v1 == u2);
+    }
+
+    /**
+     * Move shared by both tours: when `(a, b)` and `(c, d)` are shared and reconnecting them
+     * as `(a, c)`, `(b, d)` is also a valid 2-opt move in the other tour, the move is applied
+     * there if the combined cost improves. The shared count is unchanged. The caller still
+     * has to apply the move in tour `i`, whose cost change is `delta`.
+     */
+    [[gnu::hot]]
+    bool joint_two_opt(uint8_t i, double delta, unsigned a, unsigned b, unsigned c, unsigned d) {
+        const uint8_t o = 1 - i;
+        if (!this->adjacent(o, a, b) || !this->adjacent(o, c, d)) [[likely]] {
+            return false;
+        }
+
+        const unsigned x1 = this->tail(o, a, b), y1 = x1 == a ? b : a;
+        const unsigned x2 = this->tail(o, c, d), y2 = x2 == c ? d : c;
+        const bool valid = (same_edge(x1, x2, a, c) && same_edge(y1, y2, b, d))
+            || (same_edge(x1, x2, b, d) && same_edge(y1, y2, a, c));
+        if (!valid) [[unlikely]] {
+            return false;
+        }
+
+        const double joint = delta + this->cost(o, a, c) + this->cost(o, b, d)
+            - this->cost(o, a, b) - this->cost(o, c, d);
+        if (joint > -0.5) [[likely]] {
+            return false;
+        }
+
+        const auto& pos = this->pos[o];
+        auto& t = this->tours[o];
+        const bool inner = pos[y1] <= pos[x2];
+        const unsigned from = inner ? pos[y1] : pos[y2], to = inner ? pos[x2] : pos[x1];
+        std::reverse(t.begin() + from, t.begin() + to + 1);
+        this->reindex(o, from, to);
+        return true;
+    }
+
+    /**
+     * One sweep moving each path of `len` vertices of tour `i` between two vertices next to
+     * each other, one of them a candidate of an end of the path, returning if any was moved.
+     */
+    [[gnu::hot]]
+    bool or_opt(uint8_t i, unsigned len) {
+        bool changed = false;
+        for (unsigned v = 0; v < this->count(); v++) {
+            if (v % 256 == 0 && this->stop.passed()) [[unlikely]] {
+                break;
+            }
+            if (this->or_opt(i, len, this->pos[i][v])) [[unlikely]] {
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    /** First improving move of the path of `len` vertices starting at position `p` of tour `i`. */
+    [[gnu::hot]]
+    bool or_opt(uint8_t i, unsigned len, unsigned p) {
+        const unsigned n = this->count();
+        const auto& t = this->tours[i];
+
+        const unsigned prev = this->at(i, p + n - 1), first = t[p];
+        const unsigned last = this->at(i, p + len - 1), next = this->at(i, p + len);
+        const double detach = this->cost(i, prev, next) - this->cost(i, prev, first) - this->cost(i, last, next);
+        const int sdetach = int(this->adjacent(1 - i, prev, next))
+            - int(this->adjacent(1 - i, prev, first)) - int(this->adjacent(1 - i, last, next));
+
+        for (const unsigned end : { first, last }) {
+            for (const unsigned x : this->near[i][end]) {
+                // `(c, d)` is the edge right after or right before the candidate `x`
+                for (const unsigned q : { this->pos[i][x], (this->pos[i][x] + n - 1) % n }) {
+                    const unsigned off = (q + n - p) % n;
+                    if (off < len || off + 1 >= n) [[unlikely]] {
+                        continue;
+                    }
+                    const unsigned c = t[q], d = this->at(i, q + 1);
+
+                    const double base = detach - this->cost(i, c, d);
+                    const int sbase = sdetach - int(this->adjacent(1 - i, c, d));
+
+                    for (bool reversed : { false, true }) {
+                        const unsigned head = reversed ? last : first, tail = reversed ? first : last;
+
+                        const double delta = base + this->cost(i, c, head) + this->cost(i, tail, d);
+                        if (delta > -0.5) [[likely]] {
+                            continue;
+                        }
+                        const int sdelta = sbase + int(this->adjacent(1 - i, c, head)) + int(this->adjacent(1 - i, tail, d));
+                        if (!this->keeps_similarity(sdelta)) [[unlikely]] {
+                            continue;
+                        }
+
+                        this->move_segment(i, p, len, q, reversed);
+                        this->shared += sdelta;
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    /** Moves `len` vertices starting at position `p` to right after position `q`. */
+    [[gnu::hot]]
+    void move_segment(uint8_t i, unsigned p, unsigned len, unsigned q, bool reversed) {
+        const unsigned n = this->count();
+        auto& t = this->tours[i];
+
+        auto moved = tour();
+        moved.reserve(n);
+        for (unsigned off = len; off < n; off++) {
+            const unsigned v = t[(p + off) % n];
+            moved.push_back(v);
+
+            if ((p + off) % n == q) [[unlikely]] {
+                for (unsigned s = 0; s < len; s++) {
+                    moved.push_back(t[(p + (reversed ? len - 1 - s : s)) % n]);
+                }
+            }
+        }
+        t.swap(moved);
+        this->reindex(i, 0, n - 1);
+    }
+
+    [[gnu::hot]]
+    bool improve(uint8_t i) {
+        bool changed = false;
+        while (true) {
+            if (this->two_opt(i)) [[likely]] {
+                changed = true;
+                continue;
+            }
+            if (this->count() >= 8) [[likely]] {
+                if (this->or_opt(i, 1) || this->or_opt(i, 2) || this->or_opt(i, 3)) {
+                    changed = true;
+                    continue;
+                }
+            }
+            return changed;
+        }
+    }
+
+    [[gnu::hot]]
+    void descend() {
+        if (this->count() < 5) [[unlikely]] {
+            return;
+        }
+        bool changed = true;
+        while (changed && !this->stop.passed()) {
+            changed = false;
+            for (uint8_t i = 0; i <= 1; i++) {
+                changed |= this->improve(i);
+            }
+        }
+    }
+
+public:
+    /**
+     * Runs the descent on `tours`, both being complete tours over the vertices of `coords`,
+     * sharing at least `k` edges, with `near` the candidate lists of each space. Returns
+     * the polished pair, or nothing if no improving move was found before `stop`.
+     */
+    [[gnu::hot]]
+    static std::optional<utils::pair<tour>> improve(
+        const utils::columns& coords,
+        const utils::pair<neighbors>& near,
+        unsigned k,
+        const utils::pair<tour>& tours,
+        utils::deadline stop = utils::deadline()
+    ) {
+        const double before = tours[0].cost<Metric>(coords[0]) + tours[1].cost<Metric>(coords[1]);
+
+        auto paired = paired_search<Metric>(coords, near, k, tours, utils::lk_depth, stop);
+        paired.optimize();
+
+        auto search = polish(coords, near, k, paired.result(), stop);
+        if (k > 0) [[likely]] {
+            search.descend();
+        }
+
+        const double after = search.tours[0].template cost<Metric>(coords[0]) + search.tours[1].template cost<Metric>(coords[1]);
+        if (after < before - 0.5) [[likely]] {
+            return search.tours;
+        }
+        return std::nullopt;
+    }
+
+    /** Same as above, building the coordinates and candidate lists of `vertices` for a single call. */
+    [[gnu::cold]]
+    static std::optional<utils::pair<tour>> improve(
+        std::span<const vertex> vertices,
+        unsigned k,
+        const utils::pair<tour>& tours
+    ) {
+        const auto coords = utils::columns(vertices);
+        const auto near = utils::pair<neighbors> { neighbors::nearest<Metric>(coords[0]), neighbors::nearest<Metric>(coords[1]) };
+        return improve(coords, near, k, tours);
+    }
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "vertex.hpp"
+
+
+namespace utils {
+    /** Solver state at some point of the search. */
+    struct progress_event final {
+    public:
+        /** Seconds since the solver started. */
+        double time;
+        /** Cost of the best solution, infinite if there is none yet. */
+        double incumbent;
+        double bound;
+        double nodes;
+        /** Cutting planes applied by the solver. */
+        int64_t cuts;
+        /** Subtour elimination constraints added by the callback. */
+        int64_t lazy;
+    };
+}
+
+
+/**
+ * Timeline of the solver as JSON Lines, one object per event. Progress events are written at
+ * most once every `interval` seconds of solver time, so the check in the callback is all they
+ * cost in between, while every new incumbent is written as it is found.
+ */
+struct progress_log final {
+private:
+    std::ofstream file;
+    double last = -std::numeric_limits<double>::infinity();
+
+    [[gnu::hot]]
+    static inline void number(std::ostream& out, double value) {
+        if (std::isfinite(value) && std::abs(value) < 1e99) [[likely]] {
+            out << value;
+        } else {
+            out << "null";
+        }
+    }
+
+    [[gnu::hot]]
+    void write(std::string_view event, const utils::progress_event& state) {
+        const double gap = std::abs(state.incumbent - state.bound) / std::max(1e-9, std::abs(state.incumbent));
+
+        this->file << "{\"event\":\"" << event << "\",\"time\":" << state.time << ",\"incumbent\":";
+        number(this->file, state.incumbent);
+        this->file << ",\"bound\":";
+        number(this->file, state.bound);
+        this->file << ",\"gap\":";
+        number(this->file, gap);
+        this->file << ",\"nodes\":" << state.nodes << ",\"cuts\":" << state.cuts << ",\"lazy\":" << state.lazy << "}\n";
+        this->file.flush();
+    }
+
+public:
+    [[gnu::cold]]
+    explicit progress_log(const std::string& path, double interval = 1.0):
+        file(path, std::ios::out | std::ios::trunc), interval(interval)
+    {
+        if (!this->file) [[unlikely]] {
+            throw utils::invalid_file::is_not_writable(path);
+        }
+        this->file.precision(10);
+    }
+
+    /** Minimum solver time between progress events, in seconds. */
+    const double interval;
+
+    /** If a progress event at `time` would be written, so the callback only queries the solver then. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline bool due(double time) const noexcept {
+        return time - this->last >= this->interval;
+    }
+
+    /** Writes a progress event, if due. */
+    [[gnu::hot]]
+    void progress(const utils::progress_event& state) {
+        if (this->due(state.time)) [[unlikely]] {
+            this->last = state.time;
+            this->write("progress", state);
+        }
+    }
+
+    /** Writes a new incumbent, always. */
+    [[gnu::hot]]
+    void incumbent(const utils::progress_event& state) {
+        this->write("incumbent", state);
+    }
+
+    /** Writes the state the solver stopped at, always. */
+    [[gnu::cold]]
+    void finish(const utils::progress_event& state) {
+        this->write("final", state);
+    }
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <span>
+
+#include "vertex.hpp"
+#include "tour.hpp"
+#include "held_karp.hpp"
+
+
+/**
+ * Edges proven absent from every optimal pair, from the Held-Karp bounds of each space. A
+ * tour through `(u, v)` costs at least the bound of its space plus the alpha value of the
+ * edge, and the other tour at least its own bound whatever edges they share, so an edge
+ * whose two bounds add up to more than a known `k`-similar pair is useless for that `k`.
+ */
+struct pruning final {
+public:
+    /** Edges kept for each tour. */
+    utils::pair<utils::matrix<bool>> viable;
+    /** Edges eliminated from each tour. */
+    utils::pair<size_t> removed;
+    /** Products dropped from the similarity constraint, edges eliminated from either tour. */
+    size_t shared_removed;
+    /** Wall time of the pass, in seconds. */
+    double elapsed;
+
+    /** Linear nonzeros removed, two degree constraints per eliminated variable. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline size_t nonzeros() const noexcept {
+        return 2 * (this->removed[0] + this->removed[1]);
+    }
+
+    /** Eliminates the edges that no pair over `vertices` cheaper than `incumbent` may use. */
+    template <typename Metric>
+    [[gnu::cold]]
+    static pruning eliminate(std::span<const vertex> vertices, const utils::pair<tour>& incumbent) {
+        const auto start = std::chrono::steady_clock::now();
+        auto bounds = utils::pair<held_karp<Metric>> { held_karp<Metric>(vertices, 0), held_karp<Metric>(vertices, 1) };
+        auto costs = utils::pair<double>();
+        for (uint8_t i = 0; i <= 1; i++) {
+            costs[i] = incumbent[i].cost<Metric>(i, vertices);
+            bounds[i].optimize(costs[i]);
+        }
+        const double upper = costs[0] + costs[1];
+
+        auto result = pruning {
+            { bounds[0].viable(upper - bounds[1].lower_bound()), bounds[1].viable(upper - bounds[0].lower_bound()) },
+            { 0, 0 }, 0, 0.0,
+        };
+
+        const size_t n = vertices.size();
+        for (unsigned u = 0; u < n; u++) {
+            for (unsigned v = u + 1; v < n; v++) {
+                const bool first = result.viable[0][u][v], second = result.viable[1][u][v];
+                result.removed[0] += !first;
+                result.removed[1] += !second;
+                result.shared_removed += !(first && second);
+            }
+        }
+
+        const std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+        result.elapsed = secs.count();
+        return result;
+    }
+};
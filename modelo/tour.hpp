@@ -1,14 +1,34 @@
 #pragma once
 
+#include <algorithm>
 #include <optional>
+#include <ranges>
+#include <sstream>
+#include <string>
+#include <string_view>
 #include <span>
+#include <utility>
 #include <vector>
 
-#include <gurobi_c++.h>
 #include "vertex.hpp"
 
 
 namespace utils {
+    [[gnu::cold]]
+    static std::string join(std::ranges::forward_range auto range, const std::string_view& sep) {
+        std::ostringstream buf;
+        bool first = true;
+
+        for (const auto& item : range) {
+            if (!first) {
+                buf << sep;
+            }
+            buf << item;
+            first = false;
+        }
+        return buf.str();
+    }
+
     template <typename Item>
     struct matrix final {
     private:
@@ -20,6 +40,14 @@ namespace utils {
             this->buffer = new Item[n * n];
         }
 
+        inline matrix(matrix&& other) noexcept: buffer(other.buffer), len(other.len) {
+            other.buffer = nullptr;
+            other.len = 0;
+        }
+
+        matrix(const matrix&) = delete;
+        matrix& operator=(const matrix&) = delete;
+
         inline ~matrix() {
             delete[] this->buffer;
         }
@@ -44,6 +72,24 @@ namespace utils {
             return std::span<const Item>(this->buffer + idx * this->size(), this->size());
         }
     };
+
+    /** Every edge cost of one space, a row at a time over contiguous coordinates, so the inner loop vectorizes. */
+    template <typename Metric>
+    [[gnu::hot]]
+    inline matrix<double> tabulate(const plane& space) {
+        const size_t n = space.size();
+        auto table = matrix<double>(n);
+        const double *x = space.x.data(), *y = space.y.data();
+
+        for (size_t u = 0; u < n; u++) {
+            const double xu = x[u], yu = y[u];
+            double *row = table[u].data();
+            for (size_t v = 0; v < n; v++) {
+                row[v] = Metric::cost(xu, yu, x[v], y[v]);
+            }
+        }
+        return table;
+    }
 }
 
 
@@ -141,12 +187,66 @@ public:
         return min_tour;
     }
 
+    /** Every cycle in `solution`, in the order they are found. */
+    [[gnu::hot]]
+    static std::vector<tour> sub_tours(
+        std::span<const vertex> vertices,
+        const  utils::matrix<bool>& solution
+    )
+    {
+        iter_tours tours(vertices, solution);
+
+        auto all = std::vector<tour>();
+        while (auto tour = tours.next_tour()) [[likely]] {
+            all.push_back(std::move(*tour));
+        }
+        return all;
+    }
+
+    /** Adjacency matrix over `n` vertices with the edges of this tour. */
+    [[gnu::hot]]
+    utils::matrix<bool> edges(size_t n) const {
+        auto edges = utils::matrix<bool>(n);
+        std::fill_n(edges[0].data(), edges.total(), false);
+
+        for (unsigned p = 0; p < this->size(); p++) {
+            const unsigned u = (*this)[p], v = (*this)[(p + 1) % this->size()];
+            edges[u][v] = edges[v][u] = true;
+        }
+        return edges;
+    }
+
+    /** Cost of this tour in the space `i`, as indices into `vertices`. */
+    template <typename Metric>
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline double cost(uint8_t i, std::span<const vertex> vertices) const noexcept {
+        double total_cost = 0.0;
+        for (unsigned v = 0; v < this->size(); v++) {
+            const unsigned next = (v + 1) % this->size();
+            total_cost += vertices[(*this)[v]][i].cost<Metric>(vertices[(*this)[next]][i]);
+        }
+        return total_cost;
+    }
+
+    /** Cost of this tour over the coordinates of one space. */
+    template <typename Metric>
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline double cost(const utils::plane& space) const noexcept {
+        double total_cost = 0.0;
+        for (unsigned v = 0; v < this->size(); v++) {
+            const unsigned next = (v + 1) % this->size();
+            total_cost += space.cost<Metric>((*this)[v], (*this)[next]);
+        }
+        return total_cost;
+    }
+
+    template <typename Metric>
     [[gnu::pure]] [[gnu::nothrow]]
     static double cost(uint8_t i, const std::vector<vertex>& tour) noexcept {
         double total_cost = 0.0;
         for (unsigned v = 0; v < tour.size(); v++) {
             const unsigned next = (v + 1) % tour.size();
-            total_cost += tour[v][i].cost(tour[next][i]);
+            total_cost += tour[v][i].cost<Metric>(tour[next][i]);
         }
         return total_cost;
     }
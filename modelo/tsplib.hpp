@@ -0,0 +1,190 @@
+#pragma once
+
+#include <charconv>
+#include <fstream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "vertex.hpp"
+#include "instance.hpp"
+
+
+/**
+ * TSPLIB instances with a `NODE_COORD_SECTION` and `EUC_2D`, `CEIL_2D`, `ATT` or `GEO` weights,
+ * either one file per space, paired by the order of their nodes, or a single file whose
+ * coordinate lines carry both spaces as `id x1 y1 x2 y2`. Without `EDGE_WEIGHT_TYPE`, costs
+ * are rounded up as in `CEIL_2D`, like everywhere else.
+ */
+struct tsplib final {
+private:
+    struct nodes final {
+    public:
+        std::vector<unsigned> ids;
+        std::vector<double> coords;
+        /** Coordinates per node, two or four. */
+        unsigned columns = 0;
+        metric::kind measure = metric::kind::ceil_2d;
+    };
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    static inline std::string_view trim(std::string_view text) noexcept {
+        const auto first = text.find_first_not_of(" \t\r");
+        if (first == std::string_view::npos) [[unlikely]] {
+            return {};
+        }
+        return text.substr(first, text.find_last_not_of(" \t\r") - first + 1);
+    }
+
+    [[gnu::cold]]
+    static void header(const std::string& path, size_t line, std::string_view key, std::string_view value, size_t& dimension, metric::kind& measure) {
+        if (key == "TYPE" && value != "TSP") [[unlikely]] {
+            throw utils::invalid_file::uses_unsupported(path, "TYPE " + std::string(value));
+        } else if (key == "EDGE_WEIGHT_TYPE") {
+            const auto named = metric::named(value);
+            if (!named) [[unlikely]] {
+                throw utils::invalid_file::uses_unsupported(path, "EDGE_WEIGHT_TYPE " + std::string(value));
+            }
+            measure = *named;
+        } else if (key == "DIMENSION") {
+            const auto [_, error] = std::from_chars(value.data(), value.data() + value.size(), dimension);
+            if (error != std::errc()) [[unlikely]] {
+                throw utils::invalid_file::contains_invalid_data(path, line);
+            }
+        }
+    }
+
+    [[gnu::cold]]
+    static nodes read(const std::string& path) {
+        const auto file = mapped_file(path);
+        const auto text = file.contents();
+
+        auto result = nodes();
+        size_t dimension = 0;
+        bool in_section = false;
+        size_t start = 0;
+        for (size_t line = 1; start < text.size(); line++) {
+            const size_t stop = std::min(text.find('\n', start), text.size());
+            const auto current = trim(text.substr(start, stop - start));
+            start = stop + 1;
+
+            if (current.empty()) [[unlikely]] {
+                continue;
+            } else if (current == "EOF") [[unlikely]] {
+                break;
+            } else if (!in_section) {
+                if (current == "NODE_COORD_SECTION") {
+                    in_section = true;
+                    result.ids.reserve(dimension);
+                    result.coords.reserve(4 * dimension);
+                    continue;
+                }
+                const size_t colon = current.find(':');
+                if (colon == std::string_view::npos) [[unlikely]] {
+                    throw utils::invalid_file::uses_unsupported(path, "section " + std::string(current));
+                }
+                header(path, line, trim(current.substr(0, colon)), trim(current.substr(colon + 1)), dimension, result.measure);
+                continue;
+            }
+
+            // other sections may follow the coordinates
+            if (unsigned(current.front() - '0') >= 10) [[unlikely]] {
+                break;
+            }
+            double values[5];
+            unsigned count = 0;
+            const char *it = current.data(), *end = current.data() + current.size();
+            while (it < end && count < 5) {
+                it = instance::number(instance::skip_blank(it, end), end, values[count++]);
+                if (!it) [[unlikely]] {
+                    throw utils::invalid_file::contains_invalid_data(path, line);
+                }
+                it = instance::skip_blank(it, end);
+            }
+
+            const unsigned columns = count - 1;
+            if (it != end || (columns != 2 && columns != 4)) [[unlikely]] {
+                throw utils::invalid_file::contains_invalid_data(path, line);
+            } else if (result.columns != 0 && result.columns != columns) [[unlikely]] {
+                throw utils::invalid_file::contains_invalid_data(path, line);
+            }
+            result.columns = columns;
+            result.ids.push_back(unsigned(values[0]));
+            result.coords.insert(result.coords.end(), values + 1, values + count);
+        }
+
+        if (result.ids.empty() || (dimension > 0 && result.ids.size() != dimension)) [[unlikely]] {
+            throw utils::invalid_file::is_empty_or_missing(path);
+        }
+        return result;
+    }
+
+public:
+    /** If `path` names a TSPLIB file, by its extension. */
+    [[gnu::pure]] [[gnu::cold]]
+    static bool matches(std::string_view path) noexcept {
+        return path.ends_with(".tsp");
+    }
+
+    /** Both spaces from a single file, with four coordinates per node. */
+    [[gnu::cold]]
+    static instance load(const std::string& path) {
+        const auto nodes = read(path);
+        if (nodes.columns != 4) [[unlikely]] {
+            throw utils::invalid_file::uses_unsupported(path, "single space without a second file");
+        }
+
+        auto vertices = std::vector<vertex>();
+        vertices.reserve(nodes.ids.size());
+        for (size_t v = 0; v < nodes.ids.size(); v++) {
+            const double *c = &nodes.coords[4 * v];
+            vertices.push_back(vertex::with_id(nodes.ids[v], c[0], c[1], c[2], c[3]));
+        }
+        return instance(std::move(vertices)).with_metric(nodes.measure);
+    }
+
+    /** One space from each file, pairing their nodes in order, with the ids of the first. */
+    [[gnu::cold]]
+    static instance load(const std::string& first, const std::string& second) {
+        const auto a = read(first), b = read(second);
+        if (a.columns != 2) [[unlikely]] {
+            throw utils::invalid_file::uses_unsupported(first, "paired coordinates with a second file");
+        } else if (b.columns != 2) [[unlikely]] {
+            throw utils::invalid_file::uses_unsupported(second, "paired coordinates with a second file");
+        } else if (a.ids.size() != b.ids.size()) [[unlikely]] {
+            throw utils::invalid_file::uses_unsupported(second, "DIMENSION different from " + first);
+        } else if (a.measure != b.measure) [[unlikely]] {
+            throw utils::invalid_file::uses_unsupported(second, "EDGE_WEIGHT_TYPE different from " + first);
+        }
+
+        auto vertices = std::vector<vertex>();
+        vertices.reserve(a.ids.size());
+        for (size_t v = 0; v < a.ids.size(); v++) {
+            const double *p = &a.coords[2 * v], *q = &b.coords[2 * v];
+            vertices.push_back(vertex::with_id(a.ids[v], p[0], p[1], q[0], q[1]));
+        }
+        return instance(std::move(vertices)).with_metric(a.measure);
+    }
+
+    /** Writes `solution`, a tour in visiting order, as a TSPLIB `.tour` file named `name`. */
+    [[gnu::cold]]
+    static void write_tour(const std::string& path, std::string_view name, std::span<const vertex> solution) {
+        auto file = std::ofstream(path, std::ios::out | std::ios::trunc);
+        if (!file) [[unlikely]] {
+            throw utils::invalid_file::is_not_writable(path);
+        }
+
+        file << "NAME : " << name << '\n';
+        file << "TYPE : TOUR\n";
+        file << "DIMENSION : " << solution.size() << '\n';
+        file << "TOUR_SECTION\n";
+        for (const auto& v : solution) {
+            file << v.id() << '\n';
+        }
+        file << "-1\nEOF\n";
+        if (!file.flush()) [[unlikely]] {
+            throw utils::invalid_file::is_not_writable(path);
+        }
+    }
+};
@@ -2,10 +2,15 @@
 
 #include <array>
 #include <cmath>
+#include <memory>
+#include <span>
 #include <sstream>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 
+#include "metric.hpp"
+
 
 namespace utils {
     struct invalid_file final : public std::invalid_argument {
@@ -32,6 +37,23 @@ namespace utils {
         static invalid_file contains_invalid_data(const std::string& filename) {
             return invalid_file(filename, "contains invalid data");
         }
+
+        [[gnu::cold]]
+        static invalid_file is_not_writable(const std::string& filename) {
+            return invalid_file(filename, "is not writable");
+        }
+
+        [[gnu::cold]]
+        static invalid_file uses_unsupported(const std::string& filename, const std::string& feature) {
+            return invalid_file(filename, ("uses unsupported " + feature).c_str());
+        }
+
+        [[gnu::cold]]
+        static invalid_file contains_invalid_data(const std::string& filename, size_t line) {
+            std::ostringstream reason;
+            reason << "contains invalid data at line " << line;
+            return invalid_file(filename, reason.str().c_str());
+        }
     };
 
 
@@ -54,10 +76,19 @@ namespace utils {
         static not_enough_items in(std::array<Item, N> current, size_t expected) {
             return not_enough_items(typeid(Item).name(), current.size(), expected);
         }
+
+        template <typename Item> [[gnu::cold]]
+        static not_enough_items in(std::span<const Item> current, size_t expected) {
+            return not_enough_items(typeid(Item).name(), current.size(), expected);
+        }
     };
 
+    /** One item per tour, for models over a fixed number `M` of them. */
+    template <typename Item, size_t M>
+    using group = std::array<Item, M>;
+
     template <typename Item>
-    using pair = std::array<Item, 2>;
+    using pair = group<Item, 2>;
 }
 
 
@@ -72,9 +103,23 @@ public:
         [[gnu::hot]] [[gnu::nothrow]]
         constexpr inline point(double x, double y) noexcept: x(x), y(y) { }
 
+        template <typename Metric>
         [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
         constexpr inline double cost(const point& other) const noexcept {
-            return ceil(hypot(this->x - other.x, this->y - other.y));
+            return Metric::cost(this->x, this->y, other.x, other.y);
+        }
+
+        /** Coordinate on `axis`, zero for `x` and one for `y`. */
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        constexpr inline double operator[](uint8_t axis) const noexcept {
+            return axis == 0 ? this->x : this->y;
+        }
+
+        /** Squared euclidean distance, enough for ranking neighbors. */
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        constexpr inline double distance2(const point& other) const noexcept {
+            const double dx = this->x - other.x, dy = this->y - other.y;
+            return dx * dx + dy * dy;
         }
 
         [[gnu::cold]]
@@ -89,12 +134,6 @@ public:
     };
 
 private:
-    [[gnu::cold]]
-    static unsigned next_id() noexcept {
-        static unsigned count = 1;
-        return count++;
-    }
-
     [[gnu::cold]]
     inline constexpr vertex(unsigned id, double x1, double y1, double x2, double y2) noexcept:
         ident(id), p({ point(x1, y1), point(x2, y2) })
@@ -104,12 +143,16 @@ private:
     utils::pair<point> p;
 
 public:
-    constexpr vertex() noexcept: vertex(0U, 0, 0, 0, 0) {}
+    /** Coordinate spaces of each vertex. */
+    static constexpr size_t spaces = 2;
 
-    [[gnu::cold]]
-    vertex(double x1, double y1, double x2, double y2) noexcept:
-        vertex(vertex::next_id(), x1, y1, x2, y2)
-    { }
+    /** Space tour `i` is costed in by default. With more tours than spaces, they take turns. */
+    [[gnu::const]] [[gnu::cold]] [[gnu::nothrow]]
+    static constexpr inline uint8_t space_of(size_t i) noexcept {
+        return uint8_t(i % spaces);
+    }
+
+    constexpr vertex() noexcept: vertex(0U, 0, 0, 0, 0) {}
 
     [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
     constexpr inline unsigned id() const noexcept {
@@ -127,6 +170,12 @@ public:
         return vertex(id, x1, y1, x2, y2);
     }
 
+    /** Same as the template, for ids only known at runtime. */
+    [[gnu::cold]] [[gnu::nothrow]]
+    constexpr static vertex with_id(unsigned id, double x1, double y1, double x2, double y2) noexcept {
+        return vertex(id, x1, y1, x2, y2);
+    }
+
     [[gnu::cold]]
     friend inline std::ostream& operator<<(std::ostream& os, const vertex& vertex) {
         return os << "v<" << vertex.id() << ">(" << vertex.p[0] << "," << vertex.p[1] << ")";
@@ -137,3 +186,96 @@ public:
         return is >> vertex.p[0] >> vertex.p[1];
     }
 };
+
+
+namespace utils {
+    /** One space of `columns`, as two contiguous coordinate arrays. */
+    struct plane final {
+    public:
+        std::span<const double> x;
+        std::span<const double> y;
+
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline size_t size() const noexcept {
+            return this->x.size();
+        }
+
+        template <typename Metric>
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline double cost(unsigned u, unsigned v) const noexcept {
+            return Metric::cost(this->x[u], this->y[u], this->x[v], this->y[v]);
+        }
+
+        /** Monotone in the cost, enough for ranking neighbors. */
+        template <typename Metric>
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline double key(unsigned u, unsigned v) const noexcept {
+            return Metric::key(this->x[u], this->y[u], this->x[v], this->y[v]);
+        }
+
+        /** The first `n` vertices. */
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline plane first(size_t n) const noexcept {
+            return plane { this->x.first(n), this->y.first(n) };
+        }
+    };
+
+    /**
+     * Structure of arrays view of the coordinates, for the loops over many vertices. An edge
+     * cost in one space reads only the two arrays of that space, instead of striding over the
+     * ids and the other space as in `vertex`, which stays for ids and printing. Built from
+     * vertices it owns a copy, shared by every copy of it, while `view` reads arrays kept
+     * elsewhere, such as the columns of a mapped binary instance, in place.
+     */
+    struct columns final {
+    private:
+        std::shared_ptr<const std::vector<double>> storage;
+        pair<std::span<const double>> x;
+        pair<std::span<const double>> y;
+
+        [[gnu::cold]] [[gnu::nothrow]]
+        inline columns(std::shared_ptr<const std::vector<double>> storage, pair<std::span<const double>> x, pair<std::span<const double>> y) noexcept:
+            storage(std::move(storage)), x(x), y(y)
+        { }
+
+    public:
+        [[gnu::cold]]
+        explicit columns(std::span<const vertex> vertices) {
+            const size_t n = vertices.size();
+            auto owned = std::make_shared<std::vector<double>>(2 * vertex::spaces * n);
+            for (uint8_t i = 0; i < vertex::spaces; i++) {
+                double *xs = owned->data() + 2 * i * n, *ys = xs + n;
+                for (size_t v = 0; v < n; v++) {
+                    xs[v] = vertices[v][i][0];
+                    ys[v] = vertices[v][i][1];
+                }
+                this->x[i] = std::span<const double>(xs, n);
+                this->y[i] = std::span<const double>(ys, n);
+            }
+            this->storage = std::move(owned);
+        }
+
+        /** The arrays `x` and `y` of each space in place, which must outlive the view and its copies. */
+        [[gnu::cold]] [[gnu::nothrow]]
+        static inline columns view(pair<std::span<const double>> x, pair<std::span<const double>> y) noexcept {
+            return columns(nullptr, x, y);
+        }
+
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline size_t size() const noexcept {
+            return this->x[0].size();
+        }
+
+        /** Coordinates of space `i`. */
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline plane operator[](uint8_t i) const noexcept {
+            return plane { this->x[i], this->y[i] };
+        }
+
+        /** The first `n` vertices, sharing the arrays. */
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline columns first(size_t n) const noexcept {
+            return columns(this->storage, { this->x[0].first(n), this->x[1].first(n) }, { this->y[0].first(n), this->y[1].first(n) });
+        }
+    };
+}